@@ -0,0 +1,280 @@
+#ifndef RINGBUFFER_H_
+#define RINGBUFFER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+
+/**
+ * Fixed capacity ring buffer with inline storage.
+ *
+ * N is the storage capacity and must be a power of two so the index wraps with a
+ * mask. The optional window limits how many of the most recent samples are
+ * kept (e.g. RingBuffer<float, 16> buffer(10) holds the last 10 samples). Once
+ * the window is full the oldest sample is overwritten.
+ *
+ * Mean and standard deviation of the window are maintained incrementally
+ * (Welford) in single precision and are O(1). Min, max, median and the linear
+ * regression against a second buffer of timestamps are computed on demand over
+ * the most recent n samples.
+ *
+ * T can be any arithmetic type, e.g. float for weights or uint32_t for tick
+ * timestamps. The buffer never allocates, so it is safe on the stack of a task.
+ */
+template <typename T, size_t N>
+class RingBuffer
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+private:
+    static constexpr size_t mask = N - 1;
+
+    size_t read_ptr;
+    size_t write_ptr;
+    size_t count;
+    const size_t window;
+
+    // overflow
+    bool is_over_flow;
+
+    // Running statistics (Welford)
+    float running_mean;
+    float running_m2;
+
+    // container
+    T data[N];
+
+    size_t physicalIndex(size_t logical_idx) const {
+        return (read_ptr + logical_idx) & mask;
+    }
+
+    size_t clampWindow(size_t n) const {
+        return (n == 0 || n > count) ? count : n;
+    }
+
+    void statsAdd(float in) {
+        // `count` already includes the new sample
+        float delta = in - running_mean;
+        running_mean += delta / count;
+        running_m2 += delta * (in - running_mean);
+    }
+
+    void statsRemove(float out) {
+        // `count` already excludes the removed sample
+        if (count == 0) {
+            running_mean = 0.0f;
+            running_m2 = 0.0f;
+            return;
+        }
+
+        float delta = out - running_mean;
+        running_mean -= delta / count;
+        running_m2 -= delta * (out - running_mean);
+
+        // Rounding can push a near-zero variance below zero
+        if (running_m2 < 0.0f) {
+            running_m2 = 0.0f;
+        }
+    }
+
+    void statsResync() {
+        // Exact recompute to stop rounding errors from accumulating over a long
+        // running buffer. Called once per wrap, so it stays O(1) amortised.
+        float mean = 0.0f;
+        for (size_t idx = 0; idx < count; idx++) {
+            mean += (float) data[physicalIndex(idx)];
+        }
+        mean /= count;
+
+        float m2 = 0.0f;
+        for (size_t idx = 0; idx < count; idx++) {
+            float delta = (float) data[physicalIndex(idx)] - mean;
+            m2 += delta * delta;
+        }
+
+        running_mean = mean;
+        running_m2 = m2;
+    }
+
+public:
+    RingBuffer(size_t window_size = N)
+        : window((window_size == 0 || window_size > N) ? N : window_size)
+    {
+        reset();
+    }
+
+    // enqueue and dequeue
+    void enqueue(T in) {
+        // When the window is full the oldest sample is overwritten
+        if (count == window) {
+            T evicted = data[read_ptr];
+            read_ptr = (read_ptr + 1) & mask;
+            count--;
+            statsRemove((float) evicted);
+
+            is_over_flow = true;
+        }
+
+        data[write_ptr] = in;
+        write_ptr = (write_ptr + 1) & mask;
+        count++;
+
+        statsAdd((float) in);
+
+        if (write_ptr == 0) {
+            statsResync();
+        }
+    }
+
+    T dequeue() {
+        T temp = data[read_ptr];
+
+        if (count > 0) {
+            read_ptr = (read_ptr + 1) & mask;
+            count--;
+            statsRemove((float) temp);
+        }
+
+        return temp;
+    }
+
+    void reset() {
+        read_ptr = 0;
+        write_ptr = 0;
+        count = 0;
+
+        running_mean = 0.0f;
+        running_m2 = 0.0f;
+
+        clearOverFlow();
+    }
+
+    // pointer operation
+    size_t getCounter() const { return count; }
+    size_t getWindow() const { return window; }
+    bool isFull() const { return count == window; }
+
+    // overflow
+    bool getOverFlow() const { return is_over_flow; }
+    void clearOverFlow() { is_over_flow = false; }
+
+    // Oldest and newest samples
+    T first() const { return data[read_ptr]; }
+    T last() const { return data[(write_ptr - 1) & mask]; }
+
+    // Random access, 0 is the oldest sample
+    T operator[](size_t idx) const { return data[physicalIndex(idx)]; }
+
+    // Arithmetic operations over the whole window, O(1)
+    double getSum() const { return (double) running_mean * count; }
+    float getMean() const { return running_mean; }
+    float getSd() const {
+        if (count == 0) {
+            return 0.0f;
+        }
+        return sqrtf(running_m2 / count);
+    }
+
+    // Windowed queries over the most recent n samples (0: all samples)
+    T getMin(size_t n = 0) const {
+        n = clampWindow(n);
+        if (n == 0) {
+            return T();
+        }
+
+        T min_value = last();
+        for (size_t idx = count - n; idx < count; idx++) {
+            T value = (*this)[idx];
+            if (value < min_value) {
+                min_value = value;
+            }
+        }
+        return min_value;
+    }
+
+    T getMax(size_t n = 0) const {
+        n = clampWindow(n);
+        if (n == 0) {
+            return T();
+        }
+
+        T max_value = last();
+        for (size_t idx = count - n; idx < count; idx++) {
+            T value = (*this)[idx];
+            if (value > max_value) {
+                max_value = value;
+            }
+        }
+        return max_value;
+    }
+
+    T getMedian(size_t n = 0) const {
+        n = clampWindow(n);
+        if (n == 0) {
+            return T();
+        }
+
+        // Insertion sort on a copy, N is small
+        T sorted[N];
+        for (size_t idx = 0; idx < n; idx++) {
+            T value = (*this)[count - n + idx];
+            size_t pos = idx;
+            while (pos > 0 && sorted[pos - 1] > value) {
+                sorted[pos] = sorted[pos - 1];
+                pos--;
+            }
+            sorted[pos] = value;
+        }
+
+        if (n & 1) {
+            return sorted[n / 2];
+        }
+        return (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    }
+
+    /**
+     * Least squares fit of the most recent n samples against the matching samples
+     * of another buffer, e.g. weights against tick timestamps. x is taken
+     * relative to its oldest sample to keep precision (and survive tick wrap for
+     * unsigned types). Returns false if fewer than 2 paired samples or x is flat.
+     */
+    template <typename U, size_t M>
+    bool getLinearRegression(const RingBuffer<U, M> & x_buffer, size_t n, float * slope, float * intercept) const {
+        n = clampWindow(n);
+        if (n > x_buffer.getCounter()) {
+            n = x_buffer.getCounter();
+        }
+        if (n < 2) {
+            return false;
+        }
+
+        size_t x_offset = x_buffer.getCounter() - n;
+        U x_origin = x_buffer[x_offset];
+
+        float sum_x = 0.0f;
+        float sum_xx = 0.0f;
+        float sum_y = 0.0f;
+        float sum_xy = 0.0f;
+        for (size_t idx = 0; idx < n; idx++) {
+            float x = (float) (U) (x_buffer[x_offset + idx] - x_origin);
+            float y = (float) (*this)[count - n + idx];
+            sum_x += x;
+            sum_xx += x * x;
+            sum_y += y;
+            sum_xy += x * y;
+        }
+
+        float denominator = n * sum_xx - sum_x * sum_x;
+        if (denominator == 0.0f) {
+            return false;
+        }
+
+        *slope = (n * sum_xy - sum_x * sum_y) / denominator;
+        *intercept = (sum_y - *slope * sum_x) / n;
+
+        return true;
+    }
+};
+
+#endif // RINGBUFFER_H_
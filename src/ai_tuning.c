@@ -1,4 +1,5 @@
 #include "ai_tuning.h"
+#include "drop_history.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -490,6 +491,15 @@ static void finalize_recommendations(void) {
 
     g_session.state = AI_TUNING_COMPLETE;
 
+    // Keep the result in the drop history, whether or not it gets applied
+    drop_history_ai_tuning_t ai_tuning_result = {
+        .coarse_kp = g_session.recommended_coarse_kp,
+        .coarse_kd = g_session.recommended_coarse_kd,
+        .fine_kp = g_session.recommended_fine_kp,
+        .fine_kd = g_session.recommended_fine_kd,
+    };
+    drop_history_append_ai_tuning(profile_get_selected_idx(), &ai_tuning_result);
+
     printf("\n================================================\n");
     printf("AI PID Auto-Tuning COMPLETE!\n");
     printf("================================================\n");
@@ -10,87 +10,41 @@
 #include "hardware/uart.h"
 #include "configuration.h"
 #include "scale.h"
+#include "scale_frame.h"
 #include "app.h"
 
 
-typedef union {
-    struct __attribute__((__packed__)){
-        char header[2];
-        char comma;
-        char data[9];
-        char unit[3];
-        char terminator[2];
-    };
-    char bytes[17];
-} scale_standard_data_format_t;
+// Header (ST stable, US unstable, OL overload, QT counting), comma, 9 byte signed weight, 3 byte unit, \r\n
+static const scale_frame_descriptor_t and_fxi_frame_descriptor = {
+    .frame_len = 17,
+    .terminator = '\n',
+    .sync_char = SCALE_FRAME_NO_SYNC,
+    .header = NULL,
+    .sign_offset = SCALE_FRAME_FIELD_NONE,
+    .weight_offset = 3,
+    .weight_len = 9,
+    .stability_offset = 0,
+    .stable_char = 'S',
+    .unit_offset = 12,
+    .unit_len = 3,
+    .continuous_output_command = "SIR\r\n",
+    .max_baudrate = BAUDRATE_38400,
+};
 
 
 // Forward declaration
-void _and_scale_listener_task(void *p);
 void scale_press_re_zero_key();
 
 extern scale_config_t scale_config;
 
 // Instance of the scale handle for A&D FXi series
 scale_handle_t and_fxi_scale_handle = {
-    .read_loop_task = _and_scale_listener_task,
+    .read_loop_task = scale_frame_listener_task,
     .force_zero = scale_press_re_zero_key,
+    .frame_descriptor = &and_fxi_frame_descriptor,
 };
 
 
-static float _decode_measurement_msg(scale_standard_data_format_t * msg) {
-    // Decode header
-    // Doesn't really matter though..
-
-    // Decode weight information
-    char *endptr;
-    float weight = strtof(msg->data, &endptr);
-
-    if( endptr == msg->data ) {
-        // Conversion failed
-        return nanf(msg->data);
-    }
-
-    return weight;
-}
-
-
-void _and_scale_listener_task(void *p) {
-    uint8_t string_buf_idx = 0;
-    scale_standard_data_format_t frame;
-
-    while (true) {
-        // Read all data 
-        while (uart_is_readable(SCALE_UART)) {
-            char ch = uart_getc(SCALE_UART);
-
-            frame.bytes[string_buf_idx++] = ch;
-
-            // If we have received 17 bytes then we can decode the message
-            if (string_buf_idx == sizeof(scale_standard_data_format_t)) {
-                // Data is ready, send to decode
-                scale_config.current_scale_measurement = _decode_measurement_msg(&frame);
-
-                // Signal the data is ready
-                if (scale_config.scale_measurement_ready) {
-                    xSemaphoreGive(scale_config.scale_measurement_ready);
-                }
-
-                // Reset
-                string_buf_idx = 0;
-            }
-
-            // \n is the terminator. We shall reset the receive of message on receiving any of those character.
-            if (ch =='\n') {
-                string_buf_idx = 0;
-            }
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(20));
-    }
-}
-
-
 void scale_press_re_zero_key() {
     char cmd[] = "Z\r\n";
     scale_write(cmd, strlen(cmd));
@@ -130,9 +84,3 @@ void scale_display_on() {
     char cmd[] = "ON\r\n";
     scale_write(cmd, strlen(cmd));
 }
-
-
-
-// AppState_t scale_enable_fast_report(AppState_t prev_state) {
-//     // TODO: Finish this
-// }
@@ -27,6 +27,7 @@
 #include "menu.h"
 #include "profile.h"
 #include "servo_gate.h"
+#include "drop_history.h"
 
 // OTA firmware update
 #include "firmware_update/firmware_manager.h"
@@ -127,6 +128,9 @@ int main()
 
     // Initialize the servo
     servo_gate_init();
+
+    // Load the drop history from flash
+    drop_history_init();
 #endif
 
     //===========================================================================
@@ -16,7 +16,7 @@
  * 0x10005000-0x10005FFF  4 KB      Metadata Sector B (Backup)
  * 0x10006000-0x100E5FFF  896 KB    Firmware Bank A
  * 0x100E6000-0x101C5FFF  896 KB    Firmware Bank B
- * 0x101C6000-0x101FFFFF  232 KB    Reserved (Future expansion)
+ * 0x101C6000-0x101FFFFF  232 KB    Reserved, drop history log (see drop_history.h)
  */
 
 // Flash base address (XIP region)
@@ -51,7 +51,7 @@
 #define BANK_B_SIZE                 (896 * 1024)       // 896KB (917,504 bytes)
 #define BANK_B_END                  (BANK_B_ADDRESS + BANK_B_SIZE)
 
-// Reserved space
+// Reserved space, holds the drop history log
 #define RESERVED_ADDRESS            0x101C6000
 #define RESERVED_SIZE               (232 * 1024)       // 232KB
 
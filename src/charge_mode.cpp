@@ -8,9 +8,10 @@
 #include <semphr.h>
 #include <u8g2.h>
 #include <math.h>
+#include "pico/time.h"
 
 #include "app.h"
-#include "FloatRingBuffer.h"
+#include "RingBuffer.h"
 #include "mini_12864_module.h"
 #include "display.h"
 #include "scale.h"
@@ -23,6 +24,13 @@
 #include "servo_gate.h"
 #include "input_validation.h"
 #include "ai_tuning.h"
+#include "settling_detector.h"
+#include "inflight_compensation.h"
+#include "flow_model.h"
+#include "pid_controller.h"
+#include "charge_session.h"
+#include "drop_trace.h"
+#include "drop_history.h"
 
 
 uint8_t charge_weight_digits[] = {0, 0, 0, 0, 0};
@@ -49,6 +57,7 @@ const eeprom_charge_mode_data_t default_charge_mode_data = {
     .precharge_enable = false,
     .precharge_time_ms = 1000,
     .precharge_speed_rps = 2,
+    .precharge_pipelined = false,
 
     // LED related
     .neopixel_normal_charge_colour = RGB_COLOUR_GREEN,        // green
@@ -64,6 +73,53 @@ static char title_string[30];
 static TickType_t charge_start_tick = 0;
 static float last_charge_elapsed_seconds = 0.0f;
 
+// Batch mode, set up over REST and kept across charge mode sessions until stopped
+static charge_session_t charge_session;
+
+// Completion time of the previous drop in this charge mode session, for the drop history
+static bool has_last_drop = false;
+static uint32_t last_drop_us = 0;
+
+// Models learned for the profile in use, reloaded from the profile on every charge mode entry
+static inflight_compensation_t inflight_compensation;
+static flow_model_t coarse_flow_model;
+static flow_model_t fine_flow_model;
+static profile_t * learned_profile = NULL;
+static bool is_profile_learned = false;
+
+// Revolutions commanded in the current drop
+static flow_model_odometer_t coarse_odometer;
+static flow_model_odometer_t fine_odometer;
+static float drop_start_weight = 0.0f;
+
+// Motor positions at the start of the drop, the revolutions actually turned replace the odometers once it's done
+static int64_t coarse_start_position = 0;
+static int64_t fine_start_position = 0;
+
+// Precharge, the coarse trickler fills the closed gate for the next drop. When pipelined it keeps running
+// while the user removes and returns the cup.
+static flow_model_odometer_t precharge_odometer;
+static bool is_precharging = false;
+static uint32_t precharge_stop_us = 0;
+static int64_t precharge_start_position = 0;
+
+// Coarse back-off, the coarse trickler reverses a little when it cuts out to pull back the powder hanging over
+// the end of the tube
+static bool is_coarse_backing_off = false;
+static uint32_t coarse_backoff_stop_us = 0;
+
+// Time the scale needs to catch up with the powder delivered before the coarse trickler stopped
+#define COARSE_HANDOFF_HOLD_US                  (1000 * 1000)
+
+// Derivative low-pass, a couple of frames of a typical scale
+#define PID_DERIVATIVE_FILTER_TAU_S             0.2f
+#define PID_NOMINAL_FRAME_PERIOD_S              0.1f    // The profile integral gains were tuned per frame at 10 Hz
+
+// The fine trickler is only observed once the coarse powder has fully settled on the scale, and after its
+// speed has been constant for longer than the scale lag
+#define FINE_FLOW_WINDOW_DELAY_US               (2000 * 1000)
+#define FINE_FLOW_STEADY_US                     (1000 * 1000)
+
 // Menu system
 extern AppState_t exit_state;
 extern QueueHandle_t encoder_event_queue;
@@ -129,9 +185,10 @@ void scale_measurement_render_task(void *p) {
 
         // Current weight (only show values > -1.0)
         memset(current_weight_string, 0x0, sizeof(current_weight_string));
-        float scale_measurement = scale_get_current_measurement();
-        if (scale_measurement > -1.0) {
-            float_to_string(current_weight_string, scale_measurement, charge_mode_config.eeprom_charge_mode_data.decimal_places);
+        scale_measurement_t scale_measurement;
+        if (scale_get_latest_measurement(&scale_measurement) && weight_is_valid(scale_measurement.weight) &&
+            scale_measurement.weight > -WEIGHT_FIXED_SCALE) {
+            weight_to_string(current_weight_string, scale_measurement.weight, charge_mode_config.eeprom_charge_mode_data.decimal_places);
         } else {
             strcpy(current_weight_string, "---");
         }
@@ -140,6 +197,19 @@ void scale_measurement_render_task(void *p) {
         u8g2_SetFont(display_handler, u8g2_font_profont22_tf);
         u8g2_DrawStr(display_handler, 26, 35, current_weight_string);
 
+        // Batch progress and statistics
+        if (charge_session_is_active(&charge_session)) {
+            char session_string[40];
+            snprintf(session_string, sizeof(session_string), "%lu/%lu Err SD %.3f ES %.3f",
+                     charge_session.drops_completed,
+                     charge_session_get_total_drops(&charge_session),
+                     charge_session_stats_get_sd(&charge_session.thrown_error),
+                     charge_session_stats_get_es(&charge_session.thrown_error));
+
+            u8g2_SetFont(display_handler, u8g2_font_helvR08_tr);
+            u8g2_DrawStr(display_handler, 5, 48, session_string);
+        }
+
         // Draw profile name
         profile_t *current_profile = profile_get_selected();
         u8g2_SetFont(display_handler, u8g2_font_helvR08_tr);
@@ -152,6 +222,138 @@ void scale_measurement_render_task(void *p) {
 }
 
 
+// Trace what the loop commanded for this frame
+static void charge_mode_trace_sample(const scale_measurement_t * measurement, uint32_t start_us,
+                                     const pid_controller_t * fine_pid, float error, uint8_t flags) {
+    int32_t time_us = (int32_t) (measurement->tick_us - start_us);
+
+    drop_trace_record(time_us > 0 ? time_us : 0, measurement->weight,
+                      coarse_odometer.speed_rps, fine_odometer.speed_rps,
+                      fine_pid->config.kp * error,
+                      fine_pid->config.ki * fine_pid->integral,
+                      fine_pid->config.kd * fine_pid->derivative,
+                      flags);
+}
+
+
+// Target of the drop after the one in progress
+static float charge_mode_get_next_target() {
+    if (charge_session_is_active(&charge_session)) {
+        uint32_t drop_idx = (charge_session.drops_completed + 1) / charge_session.repetitions;
+        if (drop_idx < charge_session.target_count) {
+            return charge_session.targets[drop_idx];
+        }
+    }
+
+    return charge_mode_config.target_charge_weight;
+}
+
+
+// True if the drop in progress completes the batch, there is no next drop to precharge for
+static bool charge_mode_is_last_drop() {
+    return charge_session_is_active(&charge_session) &&
+           charge_session.drops_completed + 1 >= charge_session_get_total_drops(&charge_session);
+}
+
+
+static void precharge_start(uint32_t duration_ms) {
+    uint32_t now_us = time_us_32();
+    float speed = charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps;
+
+    precharge_start_position = motor_get_position(SELECT_COARSE_TRICKLER_MOTOR);
+    flow_model_odometer_set_speed(&precharge_odometer, speed, now_us);
+    motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, speed);
+
+    precharge_stop_us = now_us + duration_ms * 1000;
+    is_precharging = true;
+}
+
+static void precharge_stop() {
+    if (!is_precharging) {
+        return;
+    }
+
+    motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
+    flow_model_odometer_set_speed(&precharge_odometer, 0, time_us_32());
+    is_precharging = false;
+}
+
+// Stop a running precharge once it is due. Returns the time the caller may block for without overrunning it.
+static uint32_t precharge_poll(uint32_t block_time_ms) {
+    if (!is_precharging) {
+        return block_time_ms;
+    }
+
+    int32_t remaining_us = (int32_t) (precharge_stop_us - time_us_32());
+    if (remaining_us <= 0) {
+        precharge_stop();
+        return block_time_ms;
+    }
+
+    uint32_t remaining_ms = remaining_us / 1000 + 1;
+    return remaining_ms < block_time_ms ? remaining_ms : block_time_ms;
+}
+
+static void precharge_delay(uint32_t delay_ms) {
+    TickType_t start_tick = xTaskGetTickCount();
+    TickType_t delay_ticks = pdMS_TO_TICKS(delay_ms);
+
+    while (xTaskGetTickCount() - start_tick < delay_ticks) {
+        uint32_t remaining_ms = (delay_ticks - (xTaskGetTickCount() - start_tick)) * portTICK_PERIOD_MS;
+        vTaskDelay(pdMS_TO_TICKS(precharge_poll(remaining_ms)));
+    }
+}
+
+
+// Reverse the coarse trickler by the profile back-off angle. The motor task ramps the trickler down from its
+// current speed and back up in reverse, so the reverse speed is lowered for short angles and the stop time
+// accounts for both ramps.
+static void coarse_backoff_start(const profile_t * profile, float stopping_speed_rps, uint32_t now_us) {
+    float revs = profile->coarse_backoff_angle_deg / 360.0f;
+    float acceleration = get_motor_acceleration(SELECT_COARSE_TRICKLER_MOTOR);
+    if (revs <= 0 || acceleration <= 0 || profile->coarse_backoff_speed_rps <= 0) {
+        return;
+    }
+
+    float speed = profile->coarse_backoff_speed_rps;
+    if (revs < speed * speed / acceleration) {
+        speed = sqrtf(revs * acceleration);
+    }
+    float hold_s = revs / speed - speed / acceleration;
+    float duration_s = fabsf(stopping_speed_rps) / acceleration + speed / acceleration + hold_s;
+
+    motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, -speed);
+
+    coarse_backoff_stop_us = now_us + (uint32_t) (duration_s * 1e6f);
+    is_coarse_backing_off = true;
+}
+
+static void coarse_backoff_stop() {
+    if (!is_coarse_backing_off) {
+        return;
+    }
+
+    motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
+    is_coarse_backing_off = false;
+}
+
+// Stop the back-off once it is due. Returns the time the caller may block for without overrunning it.
+static uint32_t coarse_backoff_poll(uint32_t block_time_ms) {
+    if (!is_coarse_backing_off) {
+        return block_time_ms;
+    }
+
+    int32_t remaining_us = (int32_t) (coarse_backoff_stop_us - time_us_32());
+    if (remaining_us <= 0) {
+        coarse_backoff_stop();
+        return block_time_ms;
+    }
+
+    uint32_t remaining_ms = remaining_us / 1000 + 1;
+    return remaining_ms < block_time_ms ? remaining_ms : block_time_ms;
+}
+
+
 void charge_mode_wait_for_zero() {
     // Set colour to not ready
     neopixel_led_set_colour(
@@ -161,16 +363,26 @@ void charge_mode_wait_for_zero() {
         true
     );
     
-    // Wait for 5 measurements and wait for stable
-    FloatRingBuffer data_buffer(10);
-
     // Update current status
     snprintf(title_string, sizeof(title_string), "Waiting for Zero");
 
-    // Stop condition: 10 stable measurements in 200ms apart (2 seconds minimum)
-    while (true) {
-        TickType_t last_measurement_tick = xTaskGetTickCount();
+    // Batch mode sets the target of every drop
+    if (charge_session_is_active(&charge_session)) {
+        charge_mode_config.target_charge_weight = charge_session_get_target(&charge_session);
+    }
 
+    // Only consider measurements taken after entering this state
+    uint32_t measurement_seq = scale_get_latest_seq();
+    uint32_t start_us = time_us_32();
+
+    settling_detector_config_t settling_config;
+    settling_detector_get_default_config(&settling_config, charge_mode_config.eeprom_charge_mode_data.set_point_sd_margin);
+    settling_detector_t settling_detector;
+    settling_detector_init(&settling_detector, &settling_config, start_us);
+
+    // Stop condition: the scale reports stable at zero, or the settling detector is confident the reading has
+    // settled at zero
+    while (true) {
         // Non block waiting for the input
         ButtonEncoderEvent_t button_encoder_event = button_wait_for_input(false);
         if (button_encoder_event == BUTTON_RST_PRESSED) {
@@ -181,22 +393,30 @@ void charge_mode_wait_for_zero() {
             scale_config.scale_handle->force_zero();
         }
 
-        // Perform measurement (max delay 300 seconds   )
-        float current_measurement;
-        if (scale_block_wait_for_next_measurement(300, &current_measurement)){
-            data_buffer.enqueue(current_measurement);
+        // Perform measurement (max delay 300 ms)
+        scale_measurement_t measurement;
+        if (!scale_wait_for_measurement_since(measurement_seq, precharge_poll(300), &measurement)) {
+            continue;
         }
+        measurement_seq = measurement.seq;
 
-        // Generate stop condition
-        if (data_buffer.getCounter() >= 10){
-            if (data_buffer.getSd() < charge_mode_config.eeprom_charge_mode_data.set_point_sd_margin && 
-                abs(data_buffer.getMean()) < charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin) {
-                break;
-            }
+        if (!weight_is_valid(measurement.weight)) {
+            continue;
+        }
+        float current_measurement = weight_to_float(measurement.weight);
+
+        // Fast path, trust the scale's own stability detection
+        if (measurement.stability == SCALE_STABILITY_STABLE &&
+            fabsf(current_measurement) < charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin) {
+            charge_mode_config.zero_time_to_stable_ms = (measurement.tick_us - start_us) / 1000;
+            break;
         }
 
-        // Wait for minimum 300 ms (but can skip if previously wait already)
-        vTaskDelayUntil(&last_measurement_tick, pdMS_TO_TICKS(300));
+        if (settling_detector_update(&settling_detector, current_measurement, measurement.tick_us) &&
+            fabsf(settling_detector_get_mean(&settling_detector)) < charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin) {
+            charge_mode_config.zero_time_to_stable_ms = settling_detector.time_to_stable_ms;
+            break;
+        }
     }
 
     charge_mode_config.charge_mode_state = CHARGE_MODE_WAIT_FOR_COMPLETE;
@@ -256,80 +476,250 @@ void charge_mode_wait_for_complete() {
     float fine_trickler_min_speed = fmax(get_motor_min_speed(SELECT_FINE_TRICKLER_MOTOR),
                                          current_profile->fine_min_flow_speed_rps);
 
-    float integral = 0.0f;
-    float last_error = 0.0f;
-
-    TickType_t last_sample_tick = xTaskGetTickCount();
-    TickType_t current_sample_tick = last_sample_tick;
+    if (learned_profile != current_profile) {
+        inflight_compensation_init(&inflight_compensation, current_profile->inflight_mass, current_profile->inflight_delay_ms);
+        flow_model_init(&coarse_flow_model, current_profile->coarse_weight_per_rev);
+        flow_model_init(&fine_flow_model, current_profile->fine_weight_per_rev);
+        learned_profile = current_profile;
+    }
+    inflight_compensation_reset_flow(&inflight_compensation);
+    bool use_inflight_compensation = current_profile->inflight_compensation_enabled &&
+                                     inflight_compensation_is_ready(&inflight_compensation);
+
+    // The profile derivative gains have always applied to the error change per millisecond, and the integral
+    // gains to the error summed once per frame
+    pid_controller_config_t fine_pid_config = {
+        .kp = fine_kp,
+        .ki = current_profile->fine_ki / PID_NOMINAL_FRAME_PERIOD_S,
+        .kd = fine_kd / 1000.0f,
+        .output_min = fine_trickler_min_speed,
+        .output_max = fine_trickler_max_speed,
+        .derivative_filter_tau_s = PID_DERIVATIVE_FILTER_TAU_S,
+        .slew_rate_limit = 0,  // The motor task already ramps at the motor's angular acceleration
+    };
+    pid_controller_config_t coarse_pid_config = {
+        .kp = coarse_kp,
+        .ki = current_profile->coarse_ki / PID_NOMINAL_FRAME_PERIOD_S,
+        .kd = coarse_kd / 1000.0f,
+        .output_min = coarse_trickler_min_speed,
+        .output_max = coarse_trickler_max_speed,
+        .derivative_filter_tau_s = PID_DERIVATIVE_FILTER_TAU_S,
+        .slew_rate_limit = 0,
+    };
+    pid_controller_t fine_pid;
+    pid_controller_t coarse_pid;
+    pid_controller_init(&fine_pid, &fine_pid_config);
+    pid_controller_init(&coarse_pid, &coarse_pid_config);
+
+    // Consume every frame in order and use its arrival time rather than the time we got around to it
+    uint32_t measurement_seq = scale_get_latest_seq();
+    uint32_t start_us = time_us_32();
     TickType_t coarse_stop_tick = 0;  // Track when coarse trickler stops
     bool should_coarse_trickler_move = true;
 
+    scale_measurement_t start_measurement;
+    drop_start_weight = 0.0f;
+    if (scale_get_latest_measurement(&start_measurement) && weight_is_valid(start_measurement.weight)) {
+        drop_start_weight = weight_to_float(start_measurement.weight);
+    }
+
+    flow_model_odometer_reset(&coarse_odometer, start_us);
+    flow_model_odometer_reset(&fine_odometer, start_us);
+
+    drop_trace_begin(charge_mode_config.target_charge_weight);
+
+    // Whatever was precharged into the gate belongs to this drop
+    precharge_stop();
+    coarse_odometer.revs = precharge_odometer.revs;
+    coarse_start_position = precharge_odometer.revs > 0 ? precharge_start_position :
+                                                          motor_get_position(SELECT_COARSE_TRICKLER_MOTOR);
+    fine_start_position = motor_get_position(SELECT_FINE_TRICKLER_MOTOR);
+    flow_model_odometer_reset(&precharge_odometer, start_us);
+
+    // Time-optimal coarse phase: run the coarse trickler flat out until the flow model says everything but the
+    // coarse stop threshold has been delivered, then hand off to the PID. The revolutions are known right away
+    // while the scale lags by the in-flight delay.
+    bool is_coarse_dumping = current_profile->flow_model_enabled &&
+                             flow_model_is_ready(&coarse_flow_model) && flow_model_is_ready(&fine_flow_model);
+    float coarse_dump_weight = charge_mode_config.target_charge_weight -
+                               charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold - drop_start_weight;
+    uint32_t coarse_stop_us = start_us;
+
+    if (is_coarse_dumping) {
+        flow_model_odometer_set_speed(&coarse_odometer, coarse_trickler_max_speed, start_us);
+        motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, coarse_trickler_max_speed);
+    }
+
+    // Fine trickler observation. While it runs on its own at a constant speed the reading rises at exactly its
+    // flow rate, whatever the scale lag.
+    bool is_fine_window_open = false;
+    float fine_window_start_weight = 0.0f;
+    float fine_window_start_revs = 0.0f;
+    float fine_window_end_weight = 0.0f;
+    float fine_window_end_revs = 0.0f;
+    float fine_window_speed = 0.0f;
+
     while (true) {
         // Non block waiting for the input
         ButtonEncoderEvent_t button_encoder_event = button_wait_for_input(false);
         if (button_encoder_event == BUTTON_RST_PRESSED) {
+            drop_trace_end();
+            coarse_backoff_stop();
             charge_mode_config.charge_mode_state = CHARGE_MODE_EXIT;
             return;
         }
 
+        uint32_t block_time_ms = 200;
+        if (is_coarse_dumping) {
+            uint32_t now_us = time_us_32();
+            float coarse_weight_per_rev = flow_model_get_weight_per_rev(&coarse_flow_model, coarse_trickler_max_speed);
+            float fine_weight_per_rev = flow_model_get_weight_per_rev(&fine_flow_model, fine_odometer.speed_rps);
+            float delivered_weight = coarse_weight_per_rev * flow_model_odometer_get_revs(&coarse_odometer, now_us) +
+                                     fine_weight_per_rev * flow_model_odometer_get_revs(&fine_odometer, now_us);
+            float flow_rate = coarse_weight_per_rev * coarse_odometer.speed_rps +
+                              fine_weight_per_rev * fine_odometer.speed_rps;
+
+            if (delivered_weight >= coarse_dump_weight) {
+                is_coarse_dumping = false;
+                flow_model_odometer_set_speed(&coarse_odometer, 0, now_us);
+                motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
+                coarse_stop_tick = xTaskGetTickCount();
+                coarse_stop_us = now_us;
+
+                coarse_backoff_start(current_profile, coarse_trickler_max_speed, now_us);
+            }
+            else {
+                // Wake up in time to stop the coarse trickler on the millisecond rather than on the next frame
+                float remaining_ms = (coarse_dump_weight - delivered_weight) / flow_rate * 1000.0f;
+                block_time_ms = (uint32_t) fmaxf(1.0f, fminf(remaining_ms, 200.0f));
+            }
+        }
+
+        block_time_ms = coarse_backoff_poll(block_time_ms);
+
         // Run the PID controlled loop to start charging
         // Perform the measurement
-        float current_weight;
-        if (!scale_block_wait_for_next_measurement(200, &current_weight)) {
-            // If no measurement within 200ms then poll the button and retry
+        scale_measurement_t measurement;
+        if (!scale_wait_for_measurement_since(measurement_seq, block_time_ms, &measurement)) {
+            // If no measurement within the block time then poll the button and retry
             continue;
         }
-        current_sample_tick = xTaskGetTickCount();
+        measurement_seq = measurement.seq;
 
+        if (!weight_is_valid(measurement.weight)) {
+            continue;
+        }
+        float current_weight = weight_to_float(measurement.weight);
         float error = charge_mode_config.target_charge_weight - current_weight;
 
+        inflight_compensation_update_flow(&inflight_compensation, current_weight, measurement.tick_us);
+
+        bool is_fine_steady = !should_coarse_trickler_move && fine_odometer.speed_rps > 0 &&
+                              (int32_t) (measurement.tick_us - coarse_stop_us) > FINE_FLOW_WINDOW_DELAY_US &&
+                              (int32_t) (measurement.tick_us - fine_odometer.speed_since_us) > FINE_FLOW_STEADY_US;
+        if (is_fine_steady) {
+            fine_window_end_weight = current_weight;
+            fine_window_end_revs = flow_model_odometer_get_revs(&fine_odometer, measurement.tick_us);
+            if (!is_fine_window_open) {
+                is_fine_window_open = true;
+                fine_window_start_weight = fine_window_end_weight;
+                fine_window_start_revs = fine_window_end_revs;
+                fine_window_speed = fine_odometer.speed_rps;
+            }
+        }
+        else if (is_fine_window_open) {
+            is_fine_window_open = false;
+            flow_model_learn(&fine_flow_model, fine_window_end_weight - fine_window_start_weight, fine_window_end_revs - fine_window_start_revs,
+                             fine_window_speed);
+        }
+
+        // Once learned, stop early by the powder predicted to land after the stop. The threshold itself is kept, a
+        // smaller one would fall under the scale resolution and wait for the reading to reach the target.
+        float stop_threshold = charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold;
+        if (use_inflight_compensation) {
+            stop_threshold += inflight_compensation_predict(&inflight_compensation);
+        }
+
         // Stop condition
-        if (error < charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold) {
+        if (error < stop_threshold) {
             // Stop all motors
             motor_set_speed(SELECT_FINE_TRICKLER_MOTOR, 0);
             motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
+            is_coarse_backing_off = false;
+            flow_model_odometer_set_speed(&fine_odometer, 0, measurement.tick_us);
+            flow_model_odometer_set_speed(&coarse_odometer, 0, measurement.tick_us);
+
+            // The commanded speed misses retargeted ramps and the coarse back-off, the step count doesn't
+            coarse_odometer.revs = motor_get_revs_since(SELECT_COARSE_TRICKLER_MOTOR, coarse_start_position);
+            fine_odometer.revs = motor_get_revs_since(SELECT_FINE_TRICKLER_MOTOR, fine_start_position);
+
+            inflight_compensation_mark_stop(&inflight_compensation, current_weight);
+
+            if (is_fine_window_open) {
+                flow_model_learn(&fine_flow_model, fine_window_end_weight - fine_window_start_weight, fine_window_end_revs - fine_window_start_revs,
+                             fine_window_speed);
+            }
 
+            charge_mode_trace_sample(&measurement, start_us, &fine_pid, error, 0);
             break;
         }
 
         // Coarse trickler move condition
         else if (error < charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold && should_coarse_trickler_move) {
             should_coarse_trickler_move = false;
-            motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
-            coarse_stop_tick = xTaskGetTickCount();  // Record when coarse stops
-
-            // TODO: When tuning off the coarse trickler, also move reverse to back off some powder
+            if (coarse_odometer.speed_rps != 0) {
+                float stopping_speed = coarse_odometer.speed_rps;
+                motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
+                flow_model_odometer_set_speed(&coarse_odometer, 0, measurement.tick_us);
+                coarse_stop_tick = xTaskGetTickCount();  // Record when coarse stops
+                coarse_stop_us = measurement.tick_us;
+
+                // Pull back the powder hanging over the end of the tube so it doesn't trickle in later
+                coarse_backoff_start(current_profile, stopping_speed, time_us_32());
+            }
+            else if (!is_coarse_backing_off) {
+                motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
+            }
+            is_coarse_dumping = false;
         }
 
-        // Update PID variables
-        float elapse_time_ms = (current_sample_tick - last_sample_tick) / portTICK_RATE_MS;
-        integral += error;
-        float derivative = (error - last_error) / elapse_time_ms;
+        // Feed-forward: the speed that brings the error down to the trickler's stop threshold within the horizon at
+        // the learned flow, the PID only corrects what the model gets wrong and has the last stretch to itself
+        float fine_feed_forward = 0.0f;
+        float coarse_feed_forward = 0.0f;
+        if (current_profile->flow_model_enabled) {
+            fine_feed_forward = flow_model_get_speed_for_flow(
+                &fine_flow_model,
+                (error - charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold) / FLOW_MODEL_FF_HORIZON_S);
+            coarse_feed_forward = flow_model_get_speed_for_flow(
+                &coarse_flow_model,
+                (error - charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold) / FLOW_MODEL_FF_HORIZON_S);
+        }
 
         // Update fine trickler speed
-        float new_p = fine_kp * error;
-        float new_i = current_profile->fine_ki * integral;
-        float new_d = fine_kd * derivative;
-        float new_speed = fmax(fine_trickler_min_speed, fmin(new_p + new_i + new_d, fine_trickler_max_speed));
+        float new_speed = pid_controller_update_with_feed_forward(&fine_pid, charge_mode_config.target_charge_weight,
+                                                                  current_weight, measurement.tick_us, fine_feed_forward);
 
         motor_set_speed(SELECT_FINE_TRICKLER_MOTOR, new_speed);
+        flow_model_odometer_set_speed(&fine_odometer, new_speed, measurement.tick_us);
 
-        // Update coarse trickler speed
-        if (should_coarse_trickler_move) {
-            new_p = coarse_kp * error;
-            new_i = current_profile->coarse_ki * integral;
-            new_d = coarse_kd * derivative;
-
-            new_speed = fmax(coarse_trickler_min_speed, fmin(new_p + new_i + new_d, coarse_trickler_max_speed));
+        // Update coarse trickler speed, after a dump the scale has to catch up before the PID can take over
+        if (should_coarse_trickler_move && !is_coarse_dumping && !is_coarse_backing_off &&
+            (coarse_stop_tick == 0 || (int32_t) (measurement.tick_us - coarse_stop_us) > COARSE_HANDOFF_HOLD_US)) {
+            new_speed = pid_controller_update_with_feed_forward(&coarse_pid, charge_mode_config.target_charge_weight,
+                                                                current_weight, measurement.tick_us, coarse_feed_forward);
 
             motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, new_speed);
+            flow_model_odometer_set_speed(&coarse_odometer, new_speed, measurement.tick_us);
         }
 
-        // Record state
-        last_sample_tick = current_sample_tick;
-        last_error = error;
+        charge_mode_trace_sample(&measurement, start_us, &fine_pid, error,
+                                 (is_coarse_dumping ? DROP_TRACE_FLAG_COARSE_DUMP : 0) |
+                                 (is_fine_window_open ? DROP_TRACE_FLAG_FINE_WINDOW : 0));
     }
 
+    drop_trace_end();
+
     // Stop the timer 
     TickType_t now = xTaskGetTickCount();
     TickType_t elapsed_ticks = now - charge_start_tick;
@@ -340,16 +730,33 @@ void charge_mode_wait_for_complete() {
         servo_gate_set_state(GATE_CLOSE, true);
     }
 
-    // Precharge
-    if (charge_mode_config.eeprom_charge_mode_data.precharge_enable && servo_gate.gate_state != GATE_DISABLED) {
+    // Precharge, unless the batch ends with this drop
+    if (charge_mode_config.eeprom_charge_mode_data.precharge_enable && servo_gate.gate_state != GATE_DISABLED &&
+        !charge_mode_is_last_drop()) {
         // Set a fixed delay between closing the gate and precharge to allow the gate to fully close
         vTaskDelay(pdMS_TO_TICKS(500));
 
-        // Start the pre-charge
-        motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps);
-        vTaskDelay(pdMS_TO_TICKS(charge_mode_config.eeprom_charge_mode_data.precharge_time_ms));
+        uint32_t precharge_time_ms = charge_mode_config.eeprom_charge_mode_data.precharge_time_ms;
+
+        // Pipelined: precharge the bulk of the next charge, sized from the flow model and capped by the precharge
+        // time, and leave the motor running while the cup is handled
+        if (charge_mode_config.eeprom_charge_mode_data.precharge_pipelined) {
+            if (flow_model_is_ready(&coarse_flow_model)) {
+                float precharge_weight = charge_mode_get_next_target() -
+                                         charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold;
+                float precharge_speed = charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps;
+                float sized_time_ms = precharge_weight / flow_model_get_weight_per_rev(&coarse_flow_model, precharge_speed) /
+                                      precharge_speed * 1000.0f;
+                precharge_time_ms = (uint32_t) fmaxf(0.0f, fminf(sized_time_ms, precharge_time_ms));
+            }
 
-        motor_set_speed(SELECT_COARSE_TRICKLER_MOTOR, 0);
+            precharge_start(precharge_time_ms);
+        }
+        else {
+            precharge_start(precharge_time_ms);
+            vTaskDelay(pdMS_TO_TICKS(precharge_time_ms));
+            precharge_stop();
+        }
     }
     else {
         vTaskDelay(pdMS_TO_TICKS(20));  // Wait for other tasks to complete
@@ -391,19 +798,79 @@ void charge_mode_wait_for_complete() {
     charge_mode_config.charge_mode_state = CHARGE_MODE_WAIT_FOR_CUP_REMOVAL;
 }
 
+void charge_mode_learn_from_drop(float final_weight) {
+    float error = charge_mode_config.target_charge_weight - final_weight;
+
+    // Only learn from drops that finished normally, not e.g. a bumped cup or an aborted charge
+    if (fabsf(error) >= charge_mode_config.eeprom_charge_mode_data.coarse_stop_threshold) {
+        inflight_compensation_reset_flow(&inflight_compensation);
+        return;
+    }
+
+    if (learned_profile == NULL || !inflight_compensation_learn(&inflight_compensation, final_weight)) {
+        return;
+    }
+
+    // Whatever the fine trickler didn't deliver came from the coarse trickler, the fine trickler ran at mixed speeds
+    // so its mean is the best guess. The coarse revolutions also span mixed speeds, they only update its mean.
+    if (flow_model_is_ready(&fine_flow_model)) {
+        float coarse_weight = final_weight - drop_start_weight -
+                              fine_flow_model.weight_per_rev * fine_odometer.revs;
+        flow_model_learn(&coarse_flow_model, coarse_weight, coarse_odometer.revs, 0.0f);
+    }
+
+    learned_profile->inflight_mass = inflight_compensation.inflight_mass;
+    learned_profile->inflight_delay_ms = inflight_compensation_get_delay_ms(&inflight_compensation);
+    learned_profile->coarse_weight_per_rev = coarse_flow_model.weight_per_rev;
+    learned_profile->fine_weight_per_rev = fine_flow_model.weight_per_rev;
+    is_profile_learned = true;
+}
+
 void charge_mode_wait_for_cup_removal() {
     // Update current status
     snprintf(title_string, sizeof(title_string), "Remove Cup");
 
-    FloatRingBuffer data_buffer(5);
+    RingBuffer<float, 8> data_buffer(5);
+    RingBuffer<uint32_t, 8> tick_buffer(5);
 
     // Post charge analysis (while waiting for removal of the cup)
-    vTaskDelay(pdMS_TO_TICKS(1000));  // Wait for other tasks to complete
+    precharge_delay(1000);  // Wait for other tasks to complete
 
-    // Take current measurement
+    // Take current measurement, retry a bad frame (overload, decode error) for a while
     float current_measurement = scale_get_current_measurement();
+    uint32_t retry_seq = scale_get_latest_seq();
+    for (int retry = 0; retry < 5 && !isfinite(current_measurement); retry++) {
+        scale_measurement_t measurement;
+        if (scale_wait_for_measurement_since(retry_seq, precharge_poll(200), &measurement)) {
+            retry_seq = measurement.seq;
+            current_measurement = weight_to_float(measurement.weight);
+        }
+    }
     float error = charge_mode_config.target_charge_weight - current_measurement;
 
+    // Without a weight the drop is only counted, nothing is learned or persisted from it
+    bool is_weight_valid = isfinite(current_measurement);
+    if (is_weight_valid) {
+        charge_mode_learn_from_drop(current_measurement);
+    }
+
+    uint32_t drop_us = time_us_32();
+    if (charge_session_is_active(&charge_session)) {
+        charge_session_record_drop(&charge_session, current_measurement, drop_us);
+    }
+
+    if (is_weight_valid) {
+        drop_history_drop_t history_drop = {
+            .target_weight = charge_mode_config.target_charge_weight,
+            .thrown_weight = current_measurement,
+            .drop_time_ms = (uint32_t) (last_charge_elapsed_seconds * 1000.0f),
+            .cycle_time_ms = has_last_drop ? (drop_us - last_drop_us) / 1000 : 0,
+        };
+        drop_history_append_drop(profile_get_selected_idx(), &history_drop);
+    }
+    has_last_drop = true;
+    last_drop_us = drop_us;
+
     // Update LED colour before moving to the next stage
     // Over charged
     if (error <= -charge_mode_config.eeprom_charge_mode_data.fine_stop_threshold) {
@@ -443,10 +910,12 @@ void charge_mode_wait_for_cup_removal() {
         charge_mode_config.charge_mode_event &= ~(CHARGE_MODE_EVENT_UNDER_CHARGE | CHARGE_MODE_EVENT_OVER_CHARGE);
     }
 
-    // Stop condition: 5 stable measurements in 300ms apart (1.5 seconds minimum)
-    while (true) {
-        TickType_t last_sample_tick = xTaskGetTickCount();
+    uint32_t measurement_seq = scale_get_latest_seq();
+    uint32_t last_sample_us = 0;
 
+    // Stop condition: the scale reports stable with the cup removed, or (for scales without a stability flag)
+    // 5 stable measurements 300ms apart (1.5 seconds minimum) that aren't drifting
+    while (true) {
         // Non block waiting for the input
         ButtonEncoderEvent_t button_encoder_event = button_wait_for_input(false);
         if (button_encoder_event == BUTTON_RST_PRESSED) {
@@ -455,23 +924,47 @@ void charge_mode_wait_for_cup_removal() {
         }
 
         // Perform measurement
-        float current_weight;
-        if (!scale_block_wait_for_next_measurement(200, &current_weight)) {
+        scale_measurement_t measurement;
+        if (!scale_wait_for_measurement_since(measurement_seq, precharge_poll(200), &measurement)) {
             // If no measurement within 200ms then poll the button and retry
             continue;
         }
+        measurement_seq = measurement.seq;
+
+        if (!weight_is_valid(measurement.weight)) {
+            continue;
+        }
+        float current_weight = weight_to_float(measurement.weight);
+
+        // Fast path, trust the scale's own stability detection
+        if (measurement.stability == SCALE_STABILITY_STABLE &&
+            current_weight + 10 < charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin) {
+            break;
+        }
+
+        // Sample every 300 ms for the statistical check
+        if (data_buffer.getCounter() > 0 && measurement.tick_us - last_sample_us < 300 * 1000) {
+            continue;
+        }
         data_buffer.enqueue(current_weight);
+        tick_buffer.enqueue(measurement.tick_us);
+        last_sample_us = measurement.tick_us;
 
         // Generate stop condition
         if (data_buffer.getCounter() >= 5) {
-            if (data_buffer.getSd() < charge_mode_config.eeprom_charge_mode_data.set_point_sd_margin && 
-                data_buffer.getMean() + 10 < charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin){
+            // A slow drift (e.g. the load cell creeping back after the cup came off) can stay within the SD margin,
+            // so the slope over the window must be within the margin per second too. The median ignores one bumped
+            // frame.
+            float slope = 0.0f;
+            float intercept = 0.0f;
+            bool is_drifting = data_buffer.getLinearRegression(tick_buffer, 0, &slope, &intercept) &&
+                               fabsf(slope) * 1e6f >= charge_mode_config.eeprom_charge_mode_data.set_point_sd_margin;
+
+            if (data_buffer.getSd() < charge_mode_config.eeprom_charge_mode_data.set_point_sd_margin && !is_drifting &&
+                data_buffer.getMedian() + 10 < charge_mode_config.eeprom_charge_mode_data.set_point_mean_margin){
                 break;
             }
         }
-
-        // Wait for next measurement
-        vTaskDelayUntil(&last_sample_tick, pdMS_TO_TICKS(300));
     }
 
     // Reset LED to default colour
@@ -480,6 +973,13 @@ void charge_mode_wait_for_cup_removal() {
                             neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour,
                             true);
 
+    // The batch is done once the last cup is taken off
+    if (charge_session_is_active(&charge_session) && charge_session_is_complete(&charge_session)) {
+        charge_session_stop(&charge_session);
+        charge_mode_config.charge_mode_state = CHARGE_MODE_EXIT;
+        return;
+    }
+
     charge_mode_config.charge_mode_state = CHARGE_MODE_WAIT_FOR_CUP_RETURN;
 }
 
@@ -495,7 +995,7 @@ void charge_mode_wait_for_cup_return() {
     snprintf(title_string, sizeof(title_string), "Return Cup");
 
 
-    FloatRingBuffer data_buffer(5);
+    RingBuffer<float, 8> data_buffer(5);
 
     while (true) {
         TickType_t last_sample_tick = xTaskGetTickCount();
@@ -510,9 +1010,14 @@ void charge_mode_wait_for_cup_return() {
             scale_config.scale_handle->force_zero();
         }
 
+        // Both motors are stopped once the precharge is done, the drop history can erase ahead now
+        if (!is_precharging) {
+            drop_history_service();
+        }
+
         // Perform measurement
         float current_weight;
-        if (!scale_block_wait_for_next_measurement(200, &current_weight)) {
+        if (!scale_block_wait_for_next_measurement(precharge_poll(200), &current_weight)) {
             // If no measurement within 200ms then poll the button and retry
             continue;
         }
@@ -563,6 +1068,13 @@ uint8_t charge_mode_menu(bool charge_mode_skip_user_input) {
         vTaskResume(scale_measurement_render_task_handler);
     }
 
+    // Pick up any change made to the profile since the last session
+    learned_profile = NULL;
+    is_profile_learned = false;
+
+    flow_model_odometer_reset(&precharge_odometer, time_us_32());
+    has_last_drop = false;
+
     // Enable motor on entering the charge mode
     motor_enable(SELECT_COARSE_TRICKLER_MOTOR, true);
     motor_enable(SELECT_FINE_TRICKLER_MOTOR, true);
@@ -597,6 +1109,15 @@ uint8_t charge_mode_menu(bool charge_mode_skip_user_input) {
                             neopixel_led_config.eeprom_neopixel_led_metadata.default_led_colours.led2_colour,
                             true);
 
+    // Don't leave the coarse trickler running into the gate
+    precharge_stop();
+    coarse_backoff_stop();
+
+    // Keep what was learned for the next session, once rather than after every drop to spare the EEPROM
+    if (is_profile_learned) {
+        profile_data_save();
+    }
+
     // vTaskDelete(scale_measurement_render_handler);
     vTaskSuspend(scale_measurement_render_task_handler);
 
@@ -661,10 +1182,11 @@ bool http_rest_charge_mode_config(struct fs_file *file, int num_params, char *pa
     // c10 (bool): precharge_enable
     // c11 (int): precharge_time_ms
     // c12 (float): precharge_speed_rps
+    // c13 (bool): precharge_pipelined
 
     // ee (bool): save to eeprom
 
-    static char charge_mode_json_buffer[256];
+    static char charge_mode_json_buffer[320];
     bool save_to_eeprom = false;
     validation_result_t validation;
 
@@ -731,6 +1253,9 @@ bool http_rest_charge_mode_config(struct fs_file *file, int num_params, char *pa
             }
             charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps = precharge_speed;
         }
+        else if (strcmp(params[idx], "c13") == 0) {
+            charge_mode_config.eeprom_charge_mode_data.precharge_pipelined = string_to_boolean(values[idx]);
+        }
 
         // LED related settings (no validation needed for color values)
         else if (strcmp(params[idx], "c1") == 0) {
@@ -760,7 +1285,7 @@ bool http_rest_charge_mode_config(struct fs_file *file, int num_params, char *pa
                       sizeof(charge_mode_json_buffer),
                       "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
                       "{\"c1\":\"#%06lx\",\"c2\":\"#%06lx\",\"c3\":\"#%06lx\",\"c4\":\"#%06lx\","
-                      "\"c5\":%.3f,\"c6\":%.3f,\"c7\":%.3f,\"c8\":%.3f,\"c9\":%d,\"c10\":%s,\"c11\":%ld,\"c12\":%0.3f}",
+                      "\"c5\":%.3f,\"c6\":%.3f,\"c7\":%.3f,\"c8\":%.3f,\"c9\":%d,\"c10\":%s,\"c11\":%ld,\"c12\":%0.3f,\"c13\":%s}",
                       charge_mode_config.eeprom_charge_mode_data.neopixel_normal_charge_colour._raw_colour,
                       charge_mode_config.eeprom_charge_mode_data.neopixel_under_charge_colour._raw_colour,
                       charge_mode_config.eeprom_charge_mode_data.neopixel_over_charge_colour._raw_colour,
@@ -772,7 +1297,8 @@ bool http_rest_charge_mode_config(struct fs_file *file, int num_params, char *pa
                       charge_mode_config.eeprom_charge_mode_data.decimal_places,
                       boolean_to_string(charge_mode_config.eeprom_charge_mode_data.precharge_enable),
                       charge_mode_config.eeprom_charge_mode_data.precharge_time_ms,
-                      charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps);
+                      charge_mode_config.eeprom_charge_mode_data.precharge_speed_rps,
+                      boolean_to_string(charge_mode_config.eeprom_charge_mode_data.precharge_pipelined));
 
     CHECK_SNPRINTF_OVERFLOW(len, sizeof(charge_mode_json_buffer), file);
 
@@ -793,8 +1319,9 @@ bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *par
     // s3 (uint32_t): Charge mode event
     // s4 (string): Profile Name
     // s5 (string): Elapsed time in seconds, live during charging
+    // s6 (uint32_t): Time the last zero took to settle in ms
 
-    static char charge_mode_json_buffer[160];  // Increased to fit s5
+    static char charge_mode_json_buffer[192];  // Increased to fit s5 and s6
     char elapsed_time_buffer[16] = {0};
     validation_result_t validation;
 
@@ -835,19 +1362,19 @@ bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *par
         }
     }
 
-    // Handle the special case
-    float current_measurement = scale_get_current_measurement();
-    char weight_string[16];
-    if (isnanf(current_measurement)) {
-        sprintf(weight_string, "\"nan\"");
-    }
-    else if (isinff(current_measurement)) {
-        sprintf(weight_string, "\"inf\"");
+    // Weights are formatted from fixed point, a missing or invalid reading is reported as "nan"
+    scale_measurement_t current_measurement;
+    char weight_string[WEIGHT_FIXED_MAX_STRING_LEN + 2];
+    if (scale_get_latest_measurement(&current_measurement) && weight_is_valid(current_measurement.weight)) {
+        weight_to_string(weight_string, current_measurement.weight, DP_3);
     }
     else {
-        sprintf(weight_string, "%0.3f", current_measurement);
+        strcpy(weight_string, "\"nan\"");
     }
 
+    char target_weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+    weight_to_string(target_weight_string, weight_from_float(charge_mode_config.target_charge_weight), DP_3);
+
     // Format elapsed time
     if (charge_mode_config.charge_mode_state == CHARGE_MODE_WAIT_FOR_COMPLETE) {
         TickType_t now = xTaskGetTickCount();
@@ -861,14 +1388,15 @@ bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *par
     snprintf(charge_mode_json_buffer, 
              sizeof(charge_mode_json_buffer),
              "%s"
-             "{\"s0\":%0.3f,\"s1\":%s,\"s2\":%d,\"s3\":%lu,\"s4\":\"%s\",\"s5\":\"%s\"}",
+             "{\"s0\":%s,\"s1\":%s,\"s2\":%d,\"s3\":%lu,\"s4\":\"%s\",\"s5\":\"%s\",\"s6\":%lu}",
              http_json_header,
-             charge_mode_config.target_charge_weight,
+             target_weight_string,
              weight_string,
              (int) charge_mode_config.charge_mode_state,
              charge_mode_config.charge_mode_event,
              profile_get_selected()->name,
-             elapsed_time_buffer);
+             elapsed_time_buffer,
+             charge_mode_config.zero_time_to_stable_ms);
 
     // Clear events
     charge_mode_config.charge_mode_event = 0;
@@ -880,4 +1408,107 @@ bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *par
     file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
 
     return true;
-}
\ No newline at end of file
+}
+
+bool http_rest_charge_mode_session(struct fs_file *file, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // b0 (string): Batch targets, comma separated. Defaults to the current set point.
+    // b1 (int): Drops per target
+    // b2 (bool): Session active, true starts a new batch with b0 and b1, false stops it
+    // b3 (uint32_t): Drops completed
+    // b4 (uint32_t): Total drops
+    // b5 (float): Mean error, thrown weight minus its target
+    // b6 (float): Error SD
+    // b7 (float): Error extreme spread
+    // b8 (float): Cycle time mean in seconds
+    // b9 (float): Cycle time SD in seconds
+    // b10 (float): Fastest cycle time in seconds
+    // b11 (float): Slowest cycle time in seconds
+
+    static char charge_session_json_buffer[320];
+    validation_result_t validation;
+
+    float targets[CHARGE_SESSION_MAX_TARGETS];
+    uint8_t target_count = 0;
+    int repetitions = 1;
+
+    // Control
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "b0") == 0) {
+            char * cursor = values[idx];
+            while (*cursor != '\0') {
+                char * end;
+                float target_weight = strtof(cursor, &end);
+                if (end == cursor || target_count >= CHARGE_SESSION_MAX_TARGETS) {
+                    return send_validation_error(file, "Invalid batch targets (up to 16, comma separated)");
+                }
+
+                validation = validate_target_weight(target_weight);
+                if (!validation.is_valid) {
+                    return send_validation_error(file, validation.error_message);
+                }
+                targets[target_count++] = target_weight;
+
+                cursor = (*end == ',') ? end + 1 : end;
+            }
+        }
+        else if (strcmp(params[idx], "b1") == 0) {
+            repetitions = atoi(values[idx]);
+            validation = validate_batch_repetitions(repetitions);
+            if (!validation.is_valid) {
+                return send_validation_error(file, validation.error_message);
+            }
+        }
+    }
+
+    // Start or stop only after the batch has been parsed, whatever the parameter order
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "b2") == 0) {
+            if (string_to_boolean(values[idx])) {
+                if (target_count == 0) {
+                    targets[target_count++] = charge_mode_config.target_charge_weight;
+                }
+                if (!charge_session_start(&charge_session, targets, target_count, repetitions)) {
+                    return send_validation_error(file, "Invalid batch (1-16 targets, 1-1000 drops per target)");
+                }
+            }
+            else {
+                charge_session_stop(&charge_session);
+            }
+        }
+    }
+
+    // Response, weights are formatted from fixed point
+    char mean_weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+    char sd_weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+    char es_weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+    float_to_string(mean_weight_string, charge_session.thrown_error.mean, DP_3);
+    float_to_string(sd_weight_string, charge_session_stats_get_sd(&charge_session.thrown_error), DP_3);
+    float_to_string(es_weight_string, charge_session_stats_get_es(&charge_session.thrown_error), DP_3);
+
+    int len = snprintf(charge_session_json_buffer,
+                       sizeof(charge_session_json_buffer),
+                       "%s"
+                       "{\"b2\":%s,\"b3\":%lu,\"b4\":%lu,\"b5\":%s,\"b6\":%s,\"b7\":%s,"
+                       "\"b8\":%0.2f,\"b9\":%0.2f,\"b10\":%0.2f,\"b11\":%0.2f}",
+                       http_json_header,
+                       boolean_to_string(charge_session_is_active(&charge_session)),
+                       charge_session.drops_completed,
+                       charge_session_get_total_drops(&charge_session),
+                       mean_weight_string,
+                       sd_weight_string,
+                       es_weight_string,
+                       charge_session.cycle_time_s.mean,
+                       charge_session_stats_get_sd(&charge_session.cycle_time_s),
+                       charge_session.cycle_time_s.min,
+                       charge_session.cycle_time_s.max);
+    CHECK_SNPRINTF_OVERFLOW(len, sizeof(charge_session_json_buffer), file);
+
+    size_t data_length = strlen(charge_session_json_buffer);
+    file->data = charge_session_json_buffer;
+    file->len = data_length;
+    file->index = data_length;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+
+    return true;
+}
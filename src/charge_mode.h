@@ -7,7 +7,7 @@
 #include "neopixel_led.h"
 
 
-#define EEPROM_CHARGE_MODE_DATA_REV                     8              // 16 byte 
+#define EEPROM_CHARGE_MODE_DATA_REV                     9              // 16 byte 
 
 #define WEIGHT_STRING_LEN 8
 
@@ -34,6 +34,7 @@ typedef struct {
     bool precharge_enable;
     uint32_t precharge_time_ms;
     float precharge_speed_rps;
+    bool precharge_pipelined;           // Precharge the next drop while the cup is handled
 
     // LED related settings
     rgbw_u32_t neopixel_normal_charge_colour;
@@ -48,12 +49,16 @@ typedef struct {
     float target_charge_weight;
     uint32_t charge_mode_event;
     charge_mode_state_t charge_mode_state;
+    uint32_t zero_time_to_stable_ms;      // Time the last zero took to settle
 } charge_mode_config_t;
 
 
 bool charge_mode_config_init(void);
 uint8_t charge_mode_menu(bool charge_mode_skip_user_input);
 
+// Learn the in-flight compensation and the flow models from the settled weight of the last drop
+void charge_mode_learn_from_drop(float final_weight);
+
 // C Functions
 #ifdef __cplusplus
 extern "C" {
@@ -64,6 +69,7 @@ bool charge_mode_config_save(void);
 // REST interface
 bool http_rest_charge_mode_config(struct fs_file *file, int num_params, char *params[], char *values[]);
 bool http_rest_charge_mode_state(struct fs_file *file, int num_params, char *params[], char *values[]);
+bool http_rest_charge_mode_session(struct fs_file *file, int num_params, char *params[], char *values[]);
 
 
 #ifdef __cplusplus
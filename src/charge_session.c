@@ -0,0 +1,116 @@
+#include <math.h>
+#include <string.h>
+
+#include "charge_session.h"
+
+
+static void _stats_reset(charge_session_stats_t * stats) {
+    memset(stats, 0x0, sizeof(charge_session_stats_t));
+}
+
+
+static void _stats_update(charge_session_stats_t * stats, float value) {
+    stats->count += 1;
+
+    float delta = value - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+
+    if (stats->count == 1 || value < stats->min) {
+        stats->min = value;
+    }
+    if (stats->count == 1 || value > stats->max) {
+        stats->max = value;
+    }
+}
+
+
+float charge_session_stats_get_sd(const charge_session_stats_t * stats) {
+    if (stats->count < 2) {
+        return 0.0f;
+    }
+
+    return sqrtf(stats->m2 / (stats->count - 1));
+}
+
+
+float charge_session_stats_get_es(const charge_session_stats_t * stats) {
+    if (stats->count == 0) {
+        return 0.0f;
+    }
+
+    return stats->max - stats->min;
+}
+
+
+bool charge_session_start(charge_session_t * session, const float * targets, uint8_t target_count, uint16_t repetitions) {
+    if (target_count == 0 || target_count > CHARGE_SESSION_MAX_TARGETS ||
+        repetitions == 0 || repetitions > CHARGE_SESSION_MAX_REPETITIONS) {
+        return false;
+    }
+
+    memcpy(session->targets, targets, target_count * sizeof(float));
+    session->target_count = target_count;
+    session->repetitions = repetitions;
+
+    session->drops_completed = 0;
+    session->last_drop_us = 0;
+
+    _stats_reset(&session->thrown_error);
+    _stats_reset(&session->cycle_time_s);
+
+    session->is_active = true;
+
+    return true;
+}
+
+
+void charge_session_stop(charge_session_t * session) {
+    session->is_active = false;
+}
+
+
+bool charge_session_is_active(const charge_session_t * session) {
+    return session->is_active;
+}
+
+
+uint32_t charge_session_get_total_drops(const charge_session_t * session) {
+    return (uint32_t) session->target_count * session->repetitions;
+}
+
+
+bool charge_session_is_complete(const charge_session_t * session) {
+    return session->drops_completed >= charge_session_get_total_drops(session);
+}
+
+
+float charge_session_get_target(const charge_session_t * session) {
+    uint32_t target_idx = session->drops_completed / session->repetitions;
+
+    if (target_idx >= session->target_count) {
+        target_idx = session->target_count - 1;
+    }
+
+    return session->targets[target_idx];
+}
+
+
+void charge_session_record_drop(charge_session_t * session, float thrown_weight, uint32_t tick_us) {
+    if (!session->is_active || charge_session_is_complete(session)) {
+        return;
+    }
+
+    // The drop still counts without a weight, it just stays out of the statistics
+    if (isfinite(thrown_weight)) {
+        _stats_update(&session->thrown_error, thrown_weight - charge_session_get_target(session));
+    }
+
+    // The first drop has no previous drop to measure the cycle from
+    if (session->drops_completed > 0) {
+        _stats_update(&session->cycle_time_s, (tick_us - session->last_drop_us) / 1e6f);
+    }
+
+    session->last_drop_us = tick_us;
+    session->drops_completed += 1;
+}
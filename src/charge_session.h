@@ -0,0 +1,83 @@
+#ifndef CHARGE_SESSION_H_
+#define CHARGE_SESSION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Batch charging session
+ *
+ * Runs a queue of targets back-to-back, each repeated a number of times, e.g.
+ * 50 drops of one target or a ladder of 10 targets with 5 drops each. The
+ * charge mode takes its target from the session before every drop, so the
+ * operator doesn't re-enter anything between drops.
+ *
+ * Rolling statistics are kept for the thrown (settled) weight error, thrown
+ * minus the target of the drop, and the cycle time. The error keeps the spread
+ * of a ladder down to the dispensing error rather than the ladder steps. The cycle time is measured between consecutive drops, so it covers the
+ * charge as well as the cup handling and shows throughput regressions directly.
+ * The statistics use Welford's algorithm and never store the drops.
+ *
+ * Usage:
+ * 1. charge_session_start(&session, targets, target_count, repetitions)
+ * 2. Before each drop, charge with charge_session_get_target()
+ * 3. After each drop, charge_session_record_drop() with the settled weight
+ * 4. The session is complete once charge_session_is_complete() returns true
+ */
+
+#define CHARGE_SESSION_MAX_TARGETS              16
+#define CHARGE_SESSION_MAX_REPETITIONS          1000
+
+
+typedef struct {
+    uint32_t count;
+    float mean;
+    float m2;                     // Sum of squared deviations from the mean
+    float min;
+    float max;
+} charge_session_stats_t;
+
+typedef struct {
+    bool is_active;
+
+    float targets[CHARGE_SESSION_MAX_TARGETS];
+    uint8_t target_count;
+    uint16_t repetitions;         // Drops per target
+
+    uint32_t drops_completed;
+    uint32_t last_drop_us;
+
+    charge_session_stats_t thrown_error;  // Thrown weight minus the target of the drop
+    charge_session_stats_t cycle_time_s;
+} charge_session_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns false if the target list is empty or too long
+bool charge_session_start(charge_session_t * session, const float * targets, uint8_t target_count, uint16_t repetitions);
+void charge_session_stop(charge_session_t * session);
+
+bool charge_session_is_active(const charge_session_t * session);
+bool charge_session_is_complete(const charge_session_t * session);
+
+uint32_t charge_session_get_total_drops(const charge_session_t * session);
+
+// Target of the next drop, only valid while the session is active and not complete
+float charge_session_get_target(const charge_session_t * session);
+
+// A non-finite thrown_weight counts the drop but leaves the weight statistics alone
+void charge_session_record_drop(charge_session_t * session, float thrown_weight, uint32_t tick_us);
+
+float charge_session_stats_get_sd(const charge_session_stats_t * stats);
+
+// Extreme spread, max - min
+float charge_session_stats_get_es(const charge_session_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CHARGE_SESSION_H_
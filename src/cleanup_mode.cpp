@@ -211,7 +211,6 @@ bool http_rest_cleanup_mode_state(struct fs_file *file, int num_params, char *pa
         }
     }
 
-    // Response
     snprintf(cleanup_mode_json_buffer, 
              sizeof(cleanup_mode_json_buffer),
              "%s"
@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 #include "common.h"
+#include "weight.h"
 #include "pico/time.h"
 
 
@@ -38,18 +39,5 @@ bool string_to_boolean(char * s) {
 
 
 int float_to_string(char * output_decimal_str, float var, decimal_places_t decimal_places) {
-    int return_value = 0;
-    
-    switch (decimal_places) {
-        case DP_2:
-            return_value = sprintf(output_decimal_str, "%0.02f", var);
-            break;
-        case DP_3:
-            return_value = sprintf(output_decimal_str, "%0.03f", var);
-            break;
-        default:
-            break;
-    }
-    
-    return return_value;
-}
\ No newline at end of file
+    return weight_to_string(output_decimal_str, weight_from_float(var), decimal_places);
+}
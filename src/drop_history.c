@@ -0,0 +1,398 @@
+// Append-only drop history in the reserved flash region, see drop_history.h
+//
+// Layout: the region is split into 4 KB sectors of 128 record slots. The log is written slot by slot and sector
+// by sector, wrapping around at the end of the region. The sector after the one being written is erased ahead,
+// so it is ready for the writer to move into. The erase stalls both cores for up to 400 ms, so it is left to
+// drop_history_service() while the motors are idle. Until then that sector simply holds the oldest records.
+//
+// A slot is programmed on its own by writing its page with every other byte left at 0xFF, which doesn't change
+// the cells already programmed. A torn write fails the CRC and is skipped.
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "drop_history.h"
+#include "common.h"
+#include "weight.h"
+#include "input_validation.h"
+#include "firmware_update/flash_ops.h"
+#include "firmware_update/crc32.h"
+
+
+#define DROP_HISTORY_OFFSET                     (RESERVED_ADDRESS - FLASH_BASE_ADDRESS)
+#define DROP_HISTORY_SECTOR_COUNT               (RESERVED_SIZE / FLASH_SECTOR_SIZE)
+#define DROP_HISTORY_RECORDS_PER_SECTOR         (FLASH_SECTOR_SIZE / DROP_HISTORY_RECORD_SIZE)
+#define DROP_HISTORY_QUEUE_LEN                  8
+
+// Records per REST response
+#define DROP_HISTORY_MAX_PAGE_RECORDS           32
+
+_Static_assert(sizeof(drop_history_record_t) == DROP_HISTORY_RECORD_SIZE, "Drop history record must fill one slot");
+
+
+static QueueHandle_t drop_history_queue = NULL;
+static SemaphoreHandle_t drop_history_flash_mutex = NULL;  // Between the writer and drop_history_service()
+
+// Next slot to be written, only the writer task moves it after init
+static volatile uint32_t head_sector = 0;
+static volatile uint32_t head_slot = 0;
+
+// Cleared when the head moves into a new sector, until drop_history_service() has erased the one after it
+static bool is_next_sector_blank = true;
+
+static uint32_t next_sequence = 1;
+static uint16_t boot_id = 1;
+
+
+static uint32_t _slot_offset(uint32_t sector, uint32_t slot) {
+    return DROP_HISTORY_OFFSET + sector * FLASH_SECTOR_SIZE + slot * DROP_HISTORY_RECORD_SIZE;
+}
+
+
+static uint32_t _next_sector(uint32_t sector) {
+    return (sector + 1) % DROP_HISTORY_SECTOR_COUNT;
+}
+
+
+static uint32_t _previous_sector(uint32_t sector) {
+    return (sector + DROP_HISTORY_SECTOR_COUNT - 1) % DROP_HISTORY_SECTOR_COUNT;
+}
+
+
+static uint32_t _record_crc(const drop_history_record_t * record) {
+    return crc32_calculate((const uint8_t *) record, offsetof(drop_history_record_t, crc32));
+}
+
+
+static bool _read_slot(uint32_t sector, uint32_t slot, drop_history_record_t * record) {
+    if (flash_read(_slot_offset(sector, slot), (uint8_t *) record, sizeof(drop_history_record_t)) != FLASH_OP_SUCCESS) {
+        return false;
+    }
+
+    return record->magic == DROP_HISTORY_RECORD_MAGIC && record->crc32 == _record_crc(record);
+}
+
+
+static bool _is_slot_blank(uint32_t sector, uint32_t slot) {
+    uint32_t words[DROP_HISTORY_RECORD_SIZE / sizeof(uint32_t)];
+    flash_read(_slot_offset(sector, slot), (uint8_t *) words, sizeof(words));
+
+    for (uint32_t idx = 0; idx < DROP_HISTORY_RECORD_SIZE / sizeof(uint32_t); idx += 1) {
+        if (words[idx] != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static bool _is_sector_blank(uint32_t sector) {
+    for (uint32_t slot = 0; slot < DROP_HISTORY_RECORDS_PER_SECTOR; slot += 1) {
+        if (!_is_slot_blank(sector, slot)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static bool _ensure_sector_blank(uint32_t sector) {
+    if (_is_sector_blank(sector)) {
+        return true;
+    }
+
+    return flash_erase_region(DROP_HISTORY_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE,
+                              NULL, NULL) == FLASH_OP_SUCCESS;
+}
+
+
+static bool _program_slot(uint32_t sector, uint32_t slot, const drop_history_record_t * record) {
+    static uint8_t page_buffer[FLASH_PAGE_SIZE];
+
+    uint32_t offset = _slot_offset(sector, slot);
+    uint32_t page_offset = offset & ~(FLASH_PAGE_SIZE - 1);
+
+    memset(page_buffer, 0xFF, sizeof(page_buffer));
+    memcpy(&page_buffer[offset - page_offset], record, sizeof(drop_history_record_t));
+
+    return flash_write(page_offset, page_buffer, FLASH_PAGE_SIZE, NULL, NULL) == FLASH_OP_SUCCESS;
+}
+
+
+static void drop_history_writer_task(void *p) {
+    drop_history_record_t record;
+
+    while (true) {
+        xQueueReceive(drop_history_queue, &record, portMAX_DELAY);
+
+        xSemaphoreTake(drop_history_flash_mutex, portMAX_DELAY);
+
+        // Never move into a sector that still holds old records. The writer doesn't erase, the record is dropped
+        // if drop_history_service() hasn't had a chance yet.
+        if (!is_next_sector_blank && head_slot + 1 == DROP_HISTORY_RECORDS_PER_SECTOR) {
+            is_next_sector_blank = _is_sector_blank(_next_sector(head_sector));
+            if (!is_next_sector_blank) {
+                xSemaphoreGive(drop_history_flash_mutex);
+                printf("Drop history: erase pending, record dropped\n");
+                continue;
+            }
+        }
+
+        record.sequence = next_sequence;
+        record.boot_id = boot_id;
+        record.crc32 = _record_crc(&record);
+
+        // A failed write leaves the slot blank, the next record takes it
+        if (!_program_slot(head_sector, head_slot, &record)) {
+            xSemaphoreGive(drop_history_flash_mutex);
+            printf("Drop history: write failed, record dropped\n");
+            continue;
+        }
+        next_sequence += 1;
+
+        if (head_slot + 1 < DROP_HISTORY_RECORDS_PER_SECTOR) {
+            head_slot += 1;
+        }
+        else {
+            // The next sector is already erased. The one after it holds the oldest records, it is erased by
+            // drop_history_service().
+            head_slot = 0;
+            head_sector = _next_sector(head_sector);
+            is_next_sector_blank = false;
+        }
+
+        xSemaphoreGive(drop_history_flash_mutex);
+    }
+}
+
+
+void drop_history_service(void) {
+    if (is_next_sector_blank || drop_history_flash_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(drop_history_flash_mutex, portMAX_DELAY);
+    is_next_sector_blank = _ensure_sector_blank(_next_sector(head_sector));
+    xSemaphoreGive(drop_history_flash_mutex);
+}
+
+
+bool drop_history_init(void) {
+    drop_history_record_t record;
+
+    // The newest sector is the one whose first record has the highest sequence number
+    bool is_found = false;
+    uint32_t newest_sequence = 0;
+    for (uint32_t sector = 0; sector < DROP_HISTORY_SECTOR_COUNT; sector += 1) {
+        if (_read_slot(sector, 0, &record) && (!is_found || record.sequence > newest_sequence)) {
+            is_found = true;
+            newest_sequence = record.sequence;
+            head_sector = sector;
+        }
+    }
+
+    if (is_found) {
+        // Continue after the last slot in use
+        head_slot = DROP_HISTORY_RECORDS_PER_SECTOR;
+        for (uint32_t slot = 0; slot < DROP_HISTORY_RECORDS_PER_SECTOR; slot += 1) {
+            if (_is_slot_blank(head_sector, slot)) {
+                head_slot = slot;
+                break;
+            }
+            if (_read_slot(head_sector, slot, &record)) {
+                next_sequence = record.sequence + 1;
+                boot_id = record.boot_id + 1;
+            }
+        }
+
+        if (head_slot == DROP_HISTORY_RECORDS_PER_SECTOR) {
+            head_sector = _next_sector(head_sector);
+            head_slot = 0;
+            _ensure_sector_blank(head_sector);
+        }
+    }
+    else {
+        head_sector = 0;
+        head_slot = 0;
+        _ensure_sector_blank(head_sector);
+    }
+
+    // Keep the end of the log marked, in case the last boot stopped before the erase
+    is_next_sector_blank = _ensure_sector_blank(_next_sector(head_sector));
+
+    printf("Drop history: sector %lu, slot %lu, boot %u\n", head_sector, head_slot, boot_id);
+
+    drop_history_queue = xQueueCreate(DROP_HISTORY_QUEUE_LEN, sizeof(drop_history_record_t));
+    drop_history_flash_mutex = xSemaphoreCreateMutex();
+    if (drop_history_queue == NULL || drop_history_flash_mutex == NULL) {
+        return false;
+    }
+
+    return xTaskCreate(drop_history_writer_task, "Drop History Writer", 512, NULL, 1, NULL) == pdPASS;
+}
+
+
+static bool _append(drop_history_record_t * record) {
+    if (drop_history_queue == NULL) {
+        return false;
+    }
+
+    return xQueueSend(drop_history_queue, record, 0) == pdPASS;
+}
+
+
+bool drop_history_append_drop(uint8_t profile_idx, const drop_history_drop_t * drop) {
+    drop_history_record_t record;
+    memset(&record, 0x0, sizeof(drop_history_record_t));
+
+    record.magic = DROP_HISTORY_RECORD_MAGIC;
+    record.type = DROP_HISTORY_RECORD_DROP;
+    record.profile_idx = profile_idx;
+    record.drop = *drop;
+
+    return _append(&record);
+}
+
+
+bool drop_history_append_ai_tuning(uint8_t profile_idx, const drop_history_ai_tuning_t * ai_tuning) {
+    drop_history_record_t record;
+    memset(&record, 0x0, sizeof(drop_history_record_t));
+
+    record.magic = DROP_HISTORY_RECORD_MAGIC;
+    record.type = DROP_HISTORY_RECORD_AI_TUNING;
+    record.profile_idx = profile_idx;
+    record.ai_tuning = *ai_tuning;
+
+    return _append(&record);
+}
+
+
+uint32_t drop_history_read(uint32_t first_idx, drop_history_record_t * records, uint32_t max_records) {
+    uint32_t sector = head_sector;
+    uint32_t slot = head_slot;
+    uint32_t record_idx = 0;
+    uint32_t count = 0;
+
+    while (count < max_records) {
+        // Step back one slot, the log ends at a sector that doesn't start with a record
+        if (slot == 0) {
+            sector = _previous_sector(sector);
+            slot = DROP_HISTORY_RECORDS_PER_SECTOR;
+
+            drop_history_record_t first_record;
+            if (sector == head_sector || !_read_slot(sector, 0, &first_record)) {
+                break;
+            }
+        }
+        slot -= 1;
+
+        if (!_read_slot(sector, slot, &records[count])) {
+            continue;
+        }
+
+        if (record_idx >= first_idx) {
+            count += 1;
+        }
+        record_idx += 1;
+    }
+
+    return count;
+}
+
+
+bool http_rest_drop_history(struct fs_file *file, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // h0 (uint32_t): First record, 0 is the newest
+    // h1 (int): Number of records, up to 32
+    //
+    // Every record has
+    //   n (uint32_t): Sequence number
+    //   b (uint16_t): Boot
+    //   t (drop_history_record_type_t | int): Record type
+    //   p (uint8_t): Profile index
+    // A drop adds
+    //   w (float): Target weight
+    //   x (float): Thrown weight
+    //   d (uint32_t): Drop time in ms
+    //   c (uint32_t): Cycle time in ms, 0 for the first drop of a session
+    // An AI tuning result adds
+    //   ckp, ckd, fkp, fkd (float): Recommended coarse and fine Kp and Kd
+
+    static char drop_history_json_buffer[4096];
+    static drop_history_record_t page[DROP_HISTORY_MAX_PAGE_RECORDS];
+
+    uint32_t first_idx = 0;
+    int max_records = 16;
+
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "h0") == 0) {
+            first_idx = strtoul(values[idx], NULL, 10);
+        }
+        else if (strcmp(params[idx], "h1") == 0) {
+            max_records = atoi(values[idx]);
+            if (!is_in_range_int(max_records, 1, DROP_HISTORY_MAX_PAGE_RECORDS)) {
+                return send_validation_error(file, "Record count out of range (1-32)");
+            }
+        }
+    }
+
+    uint32_t count = drop_history_read(first_idx, page, max_records);
+
+    int len = snprintf(drop_history_json_buffer, sizeof(drop_history_json_buffer), "%s[", http_json_header);
+
+    for (uint32_t idx = 0; idx < count && len < (int) sizeof(drop_history_json_buffer); idx += 1) {
+        const drop_history_record_t * record = &page[idx];
+
+        len += snprintf(&drop_history_json_buffer[len], sizeof(drop_history_json_buffer) - len,
+                        "%s{\"n\":%lu,\"b\":%u,\"t\":%u,\"p\":%u,",
+                        idx == 0 ? "" : ",",
+                        record->sequence,
+                        record->boot_id,
+                        record->type,
+                        record->profile_idx);
+        if (len >= (int) sizeof(drop_history_json_buffer)) {
+            break;
+        }
+
+        if (record->type == DROP_HISTORY_RECORD_AI_TUNING) {
+            len += snprintf(&drop_history_json_buffer[len], sizeof(drop_history_json_buffer) - len,
+                            "\"ckp\":%0.4f,\"ckd\":%0.4f,\"fkp\":%0.4f,\"fkd\":%0.4f}",
+                            record->ai_tuning.coarse_kp,
+                            record->ai_tuning.coarse_kd,
+                            record->ai_tuning.fine_kp,
+                            record->ai_tuning.fine_kd);
+        }
+        else {
+            char target_weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+            char thrown_weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+            float_to_string(target_weight_string, record->drop.target_weight, DP_3);
+            float_to_string(thrown_weight_string, record->drop.thrown_weight, DP_3);
+
+            len += snprintf(&drop_history_json_buffer[len], sizeof(drop_history_json_buffer) - len,
+                            "\"w\":%s,\"x\":%s,\"d\":%lu,\"c\":%lu}",
+                            target_weight_string,
+                            thrown_weight_string,
+                            record->drop.drop_time_ms,
+                            record->drop.cycle_time_ms);
+        }
+    }
+
+    if (len < (int) sizeof(drop_history_json_buffer)) {
+        len += snprintf(&drop_history_json_buffer[len], sizeof(drop_history_json_buffer) - len, "]");
+    }
+    CHECK_SNPRINTF_OVERFLOW(len, sizeof(drop_history_json_buffer), file);
+
+    file->data = drop_history_json_buffer;
+    file->len = len;
+    file->index = len;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef DROP_HISTORY_H_
+#define DROP_HISTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "http_rest.h"
+
+/**
+ * Persistent drop history
+ *
+ * An append-only log of per-drop summaries and AI tuning results in the flash
+ * region reserved after the firmware banks, so it survives reboots and OTA
+ * updates. Records are 32 bytes with a sequence number and a CRC, 128 to a
+ * sector. The sectors are used in rotation, which spreads the wear evenly over
+ * the region and drops the oldest sector once the log is full (over 7000
+ * records).
+ *
+ * Records are programmed by a low priority writer task. Appending queues the
+ * record and returns immediately. A sector erase stalls both cores for up to
+ * 400 ms, so the writer never erases. The sector after the one being written is
+ * erased ahead by drop_history_service(), which the owner of the motors calls
+ * while they are stopped.
+ *
+ * Usage:
+ * 1. drop_history_init() at boot, scans the log and starts the writer task
+ * 2. drop_history_append_drop() after each drop, drop_history_append_ai_tuning()
+ *    when a tuning session completes
+ * 3. drop_history_service() at an idle point, at least once every 128 records
+ * 4. drop_history_read() walks the log from the newest record
+ */
+
+#define DROP_HISTORY_RECORD_SIZE                32
+#define DROP_HISTORY_RECORD_MAGIC               0xD5A7
+
+typedef enum {
+    DROP_HISTORY_RECORD_DROP = 1,
+    DROP_HISTORY_RECORD_AI_TUNING = 2,
+} drop_history_record_type_t;
+
+typedef struct {
+    float target_weight;
+    float thrown_weight;
+    uint32_t drop_time_ms;
+    uint32_t cycle_time_ms;             // Since the previous drop, 0 for the first drop of a session
+} drop_history_drop_t;
+
+typedef struct {
+    float coarse_kp;
+    float coarse_kd;
+    float fine_kp;
+    float fine_kd;
+} drop_history_ai_tuning_t;
+
+typedef struct {
+    uint16_t magic;
+    uint8_t type;                       // drop_history_record_type_t
+    uint8_t profile_idx;
+    uint32_t sequence;                  // Counts up over the life of the log
+    uint16_t boot_id;                   // Counts up on every boot, there is no wall clock
+    uint16_t reserved;
+    union {
+        drop_history_drop_t drop;
+        drop_history_ai_tuning_t ai_tuning;
+    };
+    uint32_t crc32;                     // Over everything before it
+} drop_history_record_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool drop_history_init(void);
+
+// Non-blocking, returns false if the writer has fallen behind and the record was dropped
+bool drop_history_append_drop(uint8_t profile_idx, const drop_history_drop_t * drop);
+bool drop_history_append_ai_tuning(uint8_t profile_idx, const drop_history_ai_tuning_t * ai_tuning);
+
+// Erases the sector ahead of the writer if needed. Blocks both cores for the length of the erase, only call while
+// no motor is running.
+void drop_history_service(void);
+
+// Copies up to max_records records starting first_idx records back from the newest (0). Returns the number of
+// records copied, fewer than max_records once the oldest record has been reached.
+uint32_t drop_history_read(uint32_t first_idx, drop_history_record_t * records, uint32_t max_records);
+
+// REST interface
+bool http_rest_drop_history(struct fs_file *file, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DROP_HISTORY_H_
@@ -0,0 +1,225 @@
+// Per-drop trace recorder, see drop_trace.h
+//
+// The charge mode task is the only writer. A REST read races with a drop in progress at worst by returning a
+// sample that is being overwritten, the trace is diagnostic only so no lock is taken in the charge loop.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "drop_trace.h"
+#include "common.h"
+#include "input_validation.h"
+
+
+#define DROP_TRACE_SAMPLE_MASK                  (DROP_TRACE_MAX_SAMPLES - 1)
+
+// Samples per REST response, each CSV row is up to ~80 characters
+#define DROP_TRACE_CSV_PAGE_SAMPLES             40
+#define DROP_TRACE_BIN_PAGE_SAMPLES             160
+
+
+static drop_trace_sample_t trace_samples[DROP_TRACE_MAX_SAMPLES];
+static uint32_t trace_head = 0;              // Free running index of the next sample
+
+static drop_trace_header_t trace_drops[DROP_TRACE_MAX_DROPS];
+static uint32_t trace_drop_count = 0;        // Drops started since boot
+static bool is_recording = false;
+
+
+static int16_t _to_centi(float value) {
+    float scaled = value * 100.0f;
+
+    // Also catches NAN, which fails every comparison
+    if (!(scaled > INT16_MIN && scaled < INT16_MAX)) {
+        return scaled < 0 ? INT16_MIN : INT16_MAX;
+    }
+    return (int16_t) lroundf(scaled);
+}
+
+
+static drop_trace_header_t * _get_drop(uint8_t drop_idx) {
+    if (drop_idx >= DROP_TRACE_MAX_DROPS || drop_idx >= trace_drop_count) {
+        return NULL;
+    }
+
+    return &trace_drops[(trace_drop_count - 1 - drop_idx) % DROP_TRACE_MAX_DROPS];
+}
+
+
+void drop_trace_begin(float target_weight) {
+    drop_trace_header_t * header = &trace_drops[trace_drop_count % DROP_TRACE_MAX_DROPS];
+
+    header->drop_id = trace_drop_count + 1;
+    header->first_sample = trace_head;
+    header->sample_count = 0;
+    header->target_weight = target_weight;
+    header->is_complete = false;
+
+    trace_drop_count += 1;
+    is_recording = true;
+}
+
+
+void drop_trace_record(uint32_t time_us, weight_fixed_t weight, float coarse_speed, float fine_speed,
+                       float p_term, float i_term, float d_term, uint8_t flags) {
+    if (!is_recording) {
+        return;
+    }
+
+    drop_trace_sample_t * sample = &trace_samples[trace_head & DROP_TRACE_SAMPLE_MASK];
+    sample->time_us = time_us;
+    sample->weight = weight;
+    sample->coarse_speed = _to_centi(coarse_speed);
+    sample->fine_speed = _to_centi(fine_speed);
+    sample->p_term = _to_centi(p_term);
+    sample->i_term = _to_centi(i_term);
+    sample->d_term = _to_centi(d_term);
+    sample->flags = flags;
+    sample->reserved = 0;
+
+    trace_head += 1;
+    _get_drop(0)->sample_count += 1;
+}
+
+
+void drop_trace_end(void) {
+    if (!is_recording) {
+        return;
+    }
+
+    _get_drop(0)->is_complete = true;
+    is_recording = false;
+}
+
+
+bool drop_trace_get_header(uint8_t drop_idx, drop_trace_header_t * header) {
+    drop_trace_header_t * drop = _get_drop(drop_idx);
+    if (drop == NULL) {
+        return false;
+    }
+
+    *header = *drop;
+    return true;
+}
+
+
+uint32_t drop_trace_read(uint8_t drop_idx, uint32_t * sample_idx, drop_trace_sample_t * samples, uint32_t max_samples) {
+    drop_trace_header_t * drop = _get_drop(drop_idx);
+    if (drop == NULL) {
+        return 0;
+    }
+
+    // Skip what has been overwritten by newer drops
+    uint32_t oldest_sample = trace_head > DROP_TRACE_MAX_SAMPLES ? trace_head - DROP_TRACE_MAX_SAMPLES : 0;
+    if (drop->first_sample + *sample_idx < oldest_sample) {
+        *sample_idx = oldest_sample - drop->first_sample;
+    }
+
+    uint32_t count = 0;
+    while (count < max_samples && *sample_idx + count < drop->sample_count) {
+        samples[count] = trace_samples[(drop->first_sample + *sample_idx + count) & DROP_TRACE_SAMPLE_MASK];
+        count += 1;
+    }
+
+    return count;
+}
+
+
+bool http_rest_drop_trace(struct fs_file *file, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // t0 (int): Drop, 0 is the latest
+    // t1 (uint32_t): First sample, long drops are read in pages
+    // t2 (string): Format, csv (default) or bin (raw drop_trace_sample_t records)
+    //
+    // The CSV starts with a comment line describing the drop. Speeds and PID terms are in rps. A page shorter
+    // than the page size is the last one.
+
+    static char drop_trace_buffer[4096];
+    static drop_trace_sample_t page[DROP_TRACE_BIN_PAGE_SAMPLES];
+
+    int drop_idx = 0;
+    uint32_t sample_idx = 0;
+    bool is_binary = false;
+
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "t0") == 0) {
+            drop_idx = atoi(values[idx]);
+            if (!is_in_range_int(drop_idx, 0, DROP_TRACE_MAX_DROPS - 1)) {
+                return send_validation_error(file, "Drop out of range (0-7)");
+            }
+        }
+        else if (strcmp(params[idx], "t1") == 0) {
+            sample_idx = strtoul(values[idx], NULL, 10);
+        }
+        else if (strcmp(params[idx], "t2") == 0) {
+            is_binary = strcmp(values[idx], "bin") == 0;
+        }
+    }
+
+    drop_trace_header_t header;
+    if (!drop_trace_get_header(drop_idx, &header)) {
+        return send_validation_error(file, "No such drop");
+    }
+
+    int len;
+    if (is_binary) {
+        uint32_t count = drop_trace_read(drop_idx, &sample_idx, page, DROP_TRACE_BIN_PAGE_SAMPLES);
+
+        len = snprintf(drop_trace_buffer, sizeof(drop_trace_buffer),
+                       "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n\r\n");
+        memcpy(&drop_trace_buffer[len], page, count * sizeof(drop_trace_sample_t));
+        len += count * sizeof(drop_trace_sample_t);
+    }
+    else {
+        uint32_t count = drop_trace_read(drop_idx, &sample_idx, page, DROP_TRACE_CSV_PAGE_SAMPLES);
+
+        weight_fixed_t target_weight = weight_from_float(header.target_weight);
+        char target_weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+        weight_to_string(target_weight_string, target_weight, DP_3);
+
+        len = snprintf(drop_trace_buffer, sizeof(drop_trace_buffer),
+                       "HTTP/1.1 200 OK\r\nContent-Type: text/csv\r\n\r\n"
+                       "# drop %lu, target %s, samples %lu, complete %s\n"
+                       "sample,time_us,weight,error,coarse_speed,fine_speed,p,i,d,flags\n",
+                       header.drop_id,
+                       target_weight_string,
+                       header.sample_count,
+                       boolean_to_string(header.is_complete));
+
+        for (uint32_t idx = 0; idx < count; idx += 1) {
+            const drop_trace_sample_t * sample = &page[idx];
+
+            char weight_string[WEIGHT_FIXED_MAX_STRING_LEN];
+            char error_string[WEIGHT_FIXED_MAX_STRING_LEN];
+            weight_to_string(weight_string, sample->weight, DP_3);
+            weight_to_string(error_string,
+                             weight_is_valid(sample->weight) ? target_weight - sample->weight : WEIGHT_FIXED_NAN,
+                             DP_3);
+
+            len += snprintf(&drop_trace_buffer[len], sizeof(drop_trace_buffer) - len,
+                            "%lu,%lu,%s,%s,%0.2f,%0.2f,%0.2f,%0.2f,%0.2f,%u\n",
+                            sample_idx + idx,
+                            sample->time_us,
+                            weight_string,
+                            error_string,
+                            sample->coarse_speed / 100.0f,
+                            sample->fine_speed / 100.0f,
+                            sample->p_term / 100.0f,
+                            sample->i_term / 100.0f,
+                            sample->d_term / 100.0f,
+                            sample->flags);
+            if (len >= (int) sizeof(drop_trace_buffer)) {
+                break;
+            }
+        }
+    }
+    CHECK_SNPRINTF_OVERFLOW(len, sizeof(drop_trace_buffer), file);
+
+    file->data = drop_trace_buffer;
+    file->len = len;
+    file->index = len;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+
+    return true;
+}
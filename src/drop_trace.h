@@ -0,0 +1,79 @@
+#ifndef DROP_TRACE_H_
+#define DROP_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "http_rest.h"
+#include "weight.h"
+
+/**
+ * Per-drop trace recorder
+ *
+ * Every drop records one compact sample per scale frame: the frame time, the
+ * weight, both commanded speeds and the fine PID terms. The samples go into a
+ * statically allocated ring shared by all drops, and a small table remembers
+ * where each of the last DROP_TRACE_MAX_DROPS drops starts. Old drops are
+ * overwritten sample by sample, a partly overwritten drop keeps its newest
+ * samples.
+ *
+ * Recording is always on and costs a copy of 20 bytes per frame. The traces are
+ * read back over REST, see http_rest_drop_trace().
+ *
+ * Usage:
+ * 1. drop_trace_begin() when the charge starts
+ * 2. drop_trace_record() with every frame
+ * 3. drop_trace_end() once the charge is complete
+ */
+
+#define DROP_TRACE_MAX_SAMPLES                  1024           // Must be power of two
+#define DROP_TRACE_MAX_DROPS                    8
+
+#define DROP_TRACE_FLAG_COARSE_DUMP             (1 << 0)       // Coarse trickler runs open loop from the flow model
+#define DROP_TRACE_FLAG_FINE_WINDOW             (1 << 1)       // Fine flow is being learned
+
+typedef struct {
+    uint32_t time_us;                   // Frame time since the start of the drop
+    weight_fixed_t weight;
+    int16_t coarse_speed;               // Commanded speeds and fine PID terms in 0.01 rps
+    int16_t fine_speed;
+    int16_t p_term;
+    int16_t i_term;
+    int16_t d_term;
+    uint8_t flags;
+    uint8_t reserved;
+} drop_trace_sample_t;
+
+typedef struct {
+    uint32_t drop_id;                   // Counts up from 1 since boot
+    uint32_t first_sample;              // Free running index into the sample ring
+    uint32_t sample_count;
+    float target_weight;
+    bool is_complete;
+} drop_trace_header_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void drop_trace_begin(float target_weight);
+void drop_trace_record(uint32_t time_us, weight_fixed_t weight, float coarse_speed, float fine_speed,
+                       float p_term, float i_term, float d_term, uint8_t flags);
+void drop_trace_end(void);
+
+// drop_idx 0 is the latest drop. Returns false if there is no such drop.
+bool drop_trace_get_header(uint8_t drop_idx, drop_trace_header_t * header);
+
+// Copies up to max_samples samples of a drop starting at *sample_idx. Samples already overwritten are skipped
+// and *sample_idx is moved to the first one copied. Returns the number of samples copied.
+uint32_t drop_trace_read(uint8_t drop_idx, uint32_t * sample_idx, drop_trace_sample_t * samples, uint32_t max_samples);
+
+// REST interface
+bool http_rest_drop_trace(struct fs_file *file, int num_params, char *params[], char *values[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DROP_TRACE_H_
@@ -3,6 +3,9 @@
 #include "hardware/flash.h"
 #include "hardware/sync.h"
 #include "hardware/watchdog.h"
+#if LIB_PICO_FLASH
+#include "pico/flash.h"
+#endif
 #include <string.h>
 #include <stdio.h>
 
@@ -10,7 +13,7 @@
  * Flash Operations Implementation
  *
  * Key safety features:
- * - All flash operations disable interrupts
+ * - All flash operations disable interrupts, and park the other core where pico_flash is linked in
  * - Watchdog fed every 10 sectors during erase (~1 second)
  * - Alignment and range checking on all operations
  * - Progress callbacks for long operations
@@ -20,6 +23,44 @@
 // Watchdog feeding interval (sectors)
 #define WATCHDOG_FEED_INTERVAL  10
 
+// How long to wait for the other core to park before giving up on a flash operation
+#define FLASH_SAFE_EXECUTE_TIMEOUT_MS   100
+
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *data;
+} flash_op_params_t;
+
+
+static void _flash_erase_sector(void *param) {
+    const flash_op_params_t *params = (const flash_op_params_t *) param;
+    flash_range_erase(params->offset, FLASH_SECTOR_SIZE);
+}
+
+
+static void _flash_program_page(void *param) {
+    const flash_op_params_t *params = (const flash_op_params_t *) param;
+    flash_range_program(params->offset, params->data, FLASH_PAGE_SIZE);
+}
+
+
+// XIP is unavailable while the flash is erased or programmed. The application runs FreeRTOS on both cores, so
+// the other core is parked through flash_safe_execute. The bootloader is single core and doesn't link pico_flash.
+static flash_op_result_t _flash_execute(void (*func)(void *), void *param) {
+#if LIB_PICO_FLASH
+    if (flash_safe_execute(func, param, FLASH_SAFE_EXECUTE_TIMEOUT_MS) != PICO_OK) {
+        return FLASH_OP_ERROR_TIMEOUT;
+    }
+#else
+    uint32_t ints = save_and_disable_interrupts();
+    func(param);
+    restore_interrupts(ints);
+#endif
+
+    return FLASH_OP_SUCCESS;
+}
+
 void flash_ops_init(void) {
     // Initialize CRC32 module
     crc32_init();
@@ -82,9 +123,11 @@ flash_op_result_t flash_erase_region(uint32_t offset, uint32_t size,
 
     for (uint32_t i = 0; i < sectors; i++) {
         // Erase sector
-        uint32_t ints = save_and_disable_interrupts();
-        flash_range_erase(current_offset, FLASH_SECTOR_SIZE);
-        restore_interrupts(ints);
+        flash_op_params_t params = {.offset = current_offset, .data = NULL};
+        flash_op_result_t result = _flash_execute(_flash_erase_sector, &params);
+        if (result != FLASH_OP_SUCCESS) {
+            return result;
+        }
 
         current_offset += FLASH_SECTOR_SIZE;
 
@@ -145,9 +188,11 @@ flash_op_result_t flash_write(uint32_t offset, const uint8_t *data, uint32_t siz
 
     for (uint32_t i = 0; i < pages; i++) {
         // Write page
-        uint32_t ints = save_and_disable_interrupts();
-        flash_range_program(current_offset, current_data, FLASH_PAGE_SIZE);
-        restore_interrupts(ints);
+        flash_op_params_t params = {.offset = current_offset, .data = current_data};
+        flash_op_result_t result = _flash_execute(_flash_program_page, &params);
+        if (result != FLASH_OP_SUCCESS) {
+            return result;
+        }
 
         current_offset += FLASH_PAGE_SIZE;
         current_data += FLASH_PAGE_SIZE;
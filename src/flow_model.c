@@ -0,0 +1,122 @@
+#include <math.h>
+#include <string.h>
+
+#include "flow_model.h"
+
+
+// EWMA smoothing of the observations, follows a change of powder within a few drops
+#define FLOW_MODEL_ALPHA                        0.3f
+
+// Observations closer in speed than this can't tell a slope from the flow noise
+#define FLOW_MODEL_MIN_SPEED_VARIANCE           0.01f       // rps^2
+
+// The line is only trusted near the speeds it was learned at, don't let it extrapolate far from the mean
+#define FLOW_MODEL_MAX_DEVIATION                0.5f
+
+
+void flow_model_init(flow_model_t * model, float weight_per_rev) {
+    memset(model, 0x0, sizeof(flow_model_t));
+
+    if (weight_per_rev > 0.0f) {
+        model->weight_per_rev = weight_per_rev;
+        model->sample_count = FLOW_MODEL_MIN_SAMPLES;
+    }
+}
+
+
+bool flow_model_is_ready(const flow_model_t * model) {
+    return model->sample_count >= FLOW_MODEL_MIN_SAMPLES;
+}
+
+
+bool flow_model_learn(flow_model_t * model, float weight, float revs, float speed_rps) {
+    if (isnan(weight) || revs < FLOW_MODEL_MIN_REVS || weight <= 0.0f) {
+        return false;
+    }
+
+    float weight_per_rev = weight / revs;
+
+    if (model->sample_count == 0) {
+        model->weight_per_rev = weight_per_rev;
+    }
+    else if (speed_rps > 0.0f && model->mean_speed_rps > 0.0f) {
+        // Exponentially weighted least squares: the mean moves along the line to the new mean speed
+        float speed_delta = speed_rps - model->mean_speed_rps;
+        float weight_delta = weight_per_rev - model->weight_per_rev;
+
+        model->mean_speed_rps += FLOW_MODEL_ALPHA * speed_delta;
+        model->weight_per_rev += FLOW_MODEL_ALPHA * weight_delta;
+        model->speed_variance = (1.0f - FLOW_MODEL_ALPHA) * (model->speed_variance + FLOW_MODEL_ALPHA * speed_delta * speed_delta);
+        model->speed_covariance = (1.0f - FLOW_MODEL_ALPHA) * (model->speed_covariance + FLOW_MODEL_ALPHA * speed_delta * weight_delta);
+    }
+    else {
+        model->weight_per_rev += FLOW_MODEL_ALPHA * (weight_per_rev - model->weight_per_rev);
+    }
+
+    if (speed_rps > 0.0f && model->mean_speed_rps <= 0.0f) {
+        model->mean_speed_rps = speed_rps;
+    }
+    model->sample_count += 1;
+
+    return true;
+}
+
+
+float flow_model_get_weight_per_rev(const flow_model_t * model, float speed_rps) {
+    if (model->speed_variance < FLOW_MODEL_MIN_SPEED_VARIANCE) {
+        return model->weight_per_rev;
+    }
+
+    float slope = model->speed_covariance / model->speed_variance;
+    float deviation = slope * (speed_rps - model->mean_speed_rps);
+    float max_deviation = FLOW_MODEL_MAX_DEVIATION * model->weight_per_rev;
+
+    return model->weight_per_rev + fmaxf(-max_deviation, fminf(deviation, max_deviation));
+}
+
+
+float flow_model_get_speed_for_flow(const flow_model_t * model, float flow) {
+    if (!flow_model_is_ready(model) || model->weight_per_rev <= 0.0f || flow <= 0.0f) {
+        return 0.0f;
+    }
+
+    // speed = flow / weight_per_rev(speed), a couple of fixed point steps from the mean converge as the
+    // deviation is bounded
+    float speed_rps = flow / model->weight_per_rev;
+    for (int iteration = 0; iteration < 3; iteration++) {
+        speed_rps = flow / flow_model_get_weight_per_rev(model, speed_rps);
+    }
+
+    return speed_rps;
+}
+
+
+void flow_model_odometer_reset(flow_model_odometer_t * odometer, uint32_t now_us) {
+    odometer->speed_rps = 0.0f;
+    odometer->revs = 0.0f;
+    odometer->last_update_us = now_us;
+    odometer->speed_since_us = now_us;
+}
+
+
+void flow_model_odometer_set_speed(flow_model_odometer_t * odometer, float speed_rps, uint32_t now_us) {
+    odometer->revs = flow_model_odometer_get_revs(odometer, now_us);
+    if (speed_rps != odometer->speed_rps) {
+        odometer->speed_rps = speed_rps;
+        odometer->speed_since_us = now_us;
+    }
+    if ((int32_t) (now_us - odometer->last_update_us) > 0) {
+        odometer->last_update_us = now_us;
+    }
+}
+
+
+float flow_model_odometer_get_revs(const flow_model_odometer_t * odometer, uint32_t now_us) {
+    // Frame times can be a little older than the last update made with the current time
+    int32_t elapsed_us = (int32_t) (now_us - odometer->last_update_us);
+    if (elapsed_us <= 0) {
+        return odometer->revs;
+    }
+
+    return odometer->revs + odometer->speed_rps * elapsed_us * 1e-6f;
+}
@@ -0,0 +1,74 @@
+#ifndef FLOW_MODEL_H_
+#define FLOW_MODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Flow model of a trickler
+ *
+ * A trickler delivers a weight per revolution for a given powder (e.g.
+ * grains/rev) that drifts with the speed, the tube fills less at high speed.
+ * The model is a line through the observations, weight_per_rev(rps), learned
+ * online from the weight delivered against the revolutions commanded. It lets
+ * the charge mode command a weight open loop (time-optimal coarse dump) and
+ * turn a desired flow into a speed (feed-forward) rather than wait for the
+ * lagging scale.
+ *
+ * Only the mean weight per revolution is persisted with the profile, the speed
+ * dependency is relearned within a session once observations at different
+ * speeds come in. Until then the model is flat.
+ *
+ * The revolutions are counted by an odometer that integrates the commanded
+ * speed, so it must see every speed change of its motor.
+ */
+
+#define FLOW_MODEL_MIN_SAMPLES                  2           // Observations before the model is used
+#define FLOW_MODEL_MIN_REVS                     1.0f        // Shorter observations are dominated by the scale resolution
+#define FLOW_MODEL_FF_HORIZON_S                 6.0f        // Feed-forward asks for the flow that closes the error in this time
+
+typedef struct {
+    float weight_per_rev;           // At mean_speed_rps
+    uint32_t sample_count;
+
+    // Exponentially weighted speed statistics of the observations with a known speed
+    float mean_speed_rps;
+    float speed_variance;
+    float speed_covariance;         // Of the speed and the weight per revolution
+} flow_model_t;
+
+typedef struct {
+    float speed_rps;
+    float revs;                     // Up to last_update_us
+    uint32_t last_update_us;
+    uint32_t speed_since_us;        // When the speed last changed
+} flow_model_odometer_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A trickler that has never been learned has weight_per_rev at 0
+void flow_model_init(flow_model_t * model, float weight_per_rev);
+
+bool flow_model_is_ready(const flow_model_t * model);
+
+// Returns false if the observation is too short or implausible to learn from. A speed of 0 marks an observation
+// over mixed speeds, it only updates the mean.
+bool flow_model_learn(flow_model_t * model, float weight, float revs, float speed_rps);
+
+float flow_model_get_weight_per_rev(const flow_model_t * model, float speed_rps);
+
+// Speed that delivers the flow (weight per second), 0 if the model isn't ready
+float flow_model_get_speed_for_flow(const flow_model_t * model, float flow);
+
+void flow_model_odometer_reset(flow_model_odometer_t * odometer, uint32_t now_us);
+void flow_model_odometer_set_speed(flow_model_odometer_t * odometer, float speed_rps, uint32_t now_us);
+float flow_model_odometer_get_revs(const flow_model_odometer_t * odometer, uint32_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // FLOW_MODEL_H_
@@ -10,6 +10,7 @@
 #include "hardware/uart.h"
 #include "configuration.h"
 #include "scale.h"
+#include "scale_frame.h"
 #include "app.h"
 
 const static char CMD_REQUEST_DATA_TRANSFER[] = "!p\r\n";
@@ -21,19 +22,25 @@ const static char CMD_BACKLIGHT[] = "!u\r\n";
 
 
 
-typedef union {
-    struct __attribute__((__packed__)){
-        char header[2];
-        char data[7];
-        char unit[3];
-        char terminator[2];
-    };
-    char bytes[14];
-} gngscale_standard_data_format_t;
+// Sign (+ or -) and space, 7 byte weight, 3 byte unit, \r\n. Sent on request only.
+static const scale_frame_descriptor_t gng_frame_descriptor = {
+    .frame_len = 14,
+    .terminator = '\n',
+    .sync_char = SCALE_FRAME_NO_SYNC,
+    .header = NULL,
+    .sign_offset = 0,
+    .weight_offset = 2,
+    .weight_len = 7,
+    .stability_offset = SCALE_FRAME_FIELD_NONE,
+    .unit_offset = 9,
+    .unit_len = 3,
+    .poll_command = CMD_REQUEST_DATA_TRANSFER,
+    .poll_period_ms = 250,
+    .max_baudrate = BAUDRATE_19200,
+};
 
 
 // Forward declaration
-void _gng_scale_listener_task(void *p);
 void scalegng_press_print_key();
 void scalegng_press_tare_key();
 
@@ -41,72 +48,12 @@ extern scale_config_t scale_config;
 
 // Instance of the scale handle for G&G JJB series
 scale_handle_t gng_scale_handle = {
-    .read_loop_task = _gng_scale_listener_task,
+    .read_loop_task = scale_frame_listener_task,
     .force_zero = scalegng_press_tare_key,
+    .frame_descriptor = &gng_frame_descriptor,
 };
 
-static float _decode_measurement_msg(gngscale_standard_data_format_t * msg) {
-    // Decode header
-    // Determine sign
-    int sign = 1;
-
-    // Check if the header contains a negative sign
-    if (msg->header[0] == '-') {
-        sign = -1;
-    }
-
-    // Decode weight information
-    char *endptr;
-    float weight = strtof(msg->data, &endptr);
-
-    if( endptr == msg->data ) {
-        // Conversion failed
-        return nanf(msg->data);
-    }
-
-    // Apply the sign
-    weight *= sign;
-
-    return weight;
-}
-
 //read UART
-void _gng_scale_listener_task(void *p) {
-    uint8_t string_buf_idx = 0;
-    gngscale_standard_data_format_t frame;
-
-    while (true) {
-        // Request for a data transfer (ESC p)
-        uart_puts(SCALE_UART, CMD_REQUEST_DATA_TRANSFER);
-
-            // Read all data 
-        while (uart_is_readable(SCALE_UART)) {   
-            char ch = uart_getc(SCALE_UART);
-            frame.bytes[string_buf_idx++] = ch;
-
-            // If we have received 14 bytes then we can decode the message
-            if (string_buf_idx == sizeof(gngscale_standard_data_format_t)) {
-                // Data is ready, send to decode
-                scale_config.current_scale_measurement = _decode_measurement_msg(&frame);
-                // Signal the data is ready
-                if (scale_config.scale_measurement_ready) {
-                    xSemaphoreGive(scale_config.scale_measurement_ready);
-                }
-
-                // Reset
-                string_buf_idx = 0;
-            }
-
-            // \n is the terminator. We shall reset the receive of message on receiving any of those character.
-            if (ch =='\n') {
-                string_buf_idx = 0;
-            }
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(250));
-    }
-}
-
 //G&G JJB key function
 //C4 communication setting - data signal command control 
 //standard ESC 0x1B to ! 0x22
@@ -0,0 +1,142 @@
+#include <math.h>
+#include <string.h>
+
+#include "inflight_compensation.h"
+
+
+// Older drops are forgotten so the model follows e.g. a change of trickler speed or the powder lot
+#define FORGETTING_FACTOR                   0.9f
+
+// Initial uncertainty of [inflight_mass, delay_s], the prior is weak compared to one drop
+#define INITIAL_MASS_VARIANCE               1.0f
+#define INITIAL_DELAY_VARIANCE              1.0f
+
+// Learned values loaded from the profile are trusted as if they had been learned from a few drops
+#define LEARNED_VARIANCE_SCALE              0.1f
+
+
+void inflight_compensation_init(inflight_compensation_t * compensation, float inflight_mass, float delay_ms) {
+    memset(compensation, 0x0, sizeof(inflight_compensation_t));
+
+    compensation->inflight_mass = inflight_mass;
+    compensation->delay_s = delay_ms / 1000.0f;
+
+    float variance_scale = 1.0f;
+    if (inflight_mass != 0.0f || delay_ms != 0.0f) {
+        compensation->drop_count = INFLIGHT_COMPENSATION_MIN_DROPS;
+        variance_scale = LEARNED_VARIANCE_SCALE;
+    }
+
+    compensation->covariance[0][0] = INITIAL_MASS_VARIANCE * variance_scale;
+    compensation->covariance[1][1] = INITIAL_DELAY_VARIANCE * variance_scale;
+}
+
+
+void inflight_compensation_reset_flow(inflight_compensation_t * compensation) {
+    compensation->history_len = 0;
+    compensation->history_idx = 0;
+    compensation->flow_rate = 0.0f;
+    compensation->frame_interval_s = 0.0f;
+    compensation->is_stop_marked = false;
+}
+
+
+void inflight_compensation_update_flow(inflight_compensation_t * compensation, float weight, uint32_t tick_us) {
+    if (isnan(weight)) {
+        return;
+    }
+
+    // The oldest sample is overwritten by this one
+    uint8_t oldest_idx = compensation->history_idx;
+    if (compensation->history_len > 0) {
+        uint8_t newest_idx = (oldest_idx + INFLIGHT_COMPENSATION_FLOW_WINDOW - 1) % INFLIGHT_COMPENSATION_FLOW_WINDOW;
+        compensation->frame_interval_s = (tick_us - compensation->tick_us_history[newest_idx]) * 1e-6f;
+    }
+    if (compensation->history_len == INFLIGHT_COMPENSATION_FLOW_WINDOW) {
+        uint32_t elapsed_us = tick_us - compensation->tick_us_history[oldest_idx];
+        if (elapsed_us > 0) {
+            // Measured across the window so the scale resolution is divided over several frames
+            compensation->flow_rate = (weight - compensation->weight_history[oldest_idx]) * 1e6f / elapsed_us;
+        }
+    }
+    else {
+        compensation->history_len += 1;
+    }
+
+    compensation->weight_history[oldest_idx] = weight;
+    compensation->tick_us_history[oldest_idx] = tick_us;
+    compensation->history_idx = (oldest_idx + 1) % INFLIGHT_COMPENSATION_FLOW_WINDOW;
+}
+
+
+bool inflight_compensation_is_ready(const inflight_compensation_t * compensation) {
+    return compensation->drop_count >= INFLIGHT_COMPENSATION_MIN_DROPS;
+}
+
+
+float inflight_compensation_predict(const inflight_compensation_t * compensation) {
+    // Powder doesn't fly upwards, a falling reading (e.g. noise) predicts no flow
+    float flow_rate = fmaxf(compensation->flow_rate, 0.0f);
+
+    // The stop can only happen on a frame, on average the error crosses the threshold half a frame of flow
+    // before the frame that sees it
+    float delay_s = compensation->delay_s + 0.5f * compensation->frame_interval_s;
+
+    return fmaxf(compensation->inflight_mass + flow_rate * delay_s, 0.0f);
+}
+
+
+void inflight_compensation_mark_stop(inflight_compensation_t * compensation, float weight_at_stop) {
+    compensation->is_stop_marked = true;
+    compensation->weight_at_stop = weight_at_stop;
+    compensation->flow_rate_at_stop = fmaxf(compensation->flow_rate, 0.0f);
+}
+
+
+bool inflight_compensation_learn(inflight_compensation_t * compensation, float final_weight) {
+    if (!compensation->is_stop_marked || isnan(final_weight)) {
+        return false;
+    }
+    compensation->is_stop_marked = false;
+
+    float carry_over = final_weight - compensation->weight_at_stop;
+
+    // Recursive least squares with y = carry_over and x = [1, flow_rate_at_stop]
+    float x0 = 1.0f;
+    float x1 = compensation->flow_rate_at_stop;
+    float (*p)[2] = compensation->covariance;
+
+    // Forgetting is suspended once the covariance trace exceeds its initial value. With a poorly excited input
+    // (e.g. the flow rate at the stop is always the same) dividing by lambda every drop would wind it up.
+    float lambda = (p[0][0] + p[1][1] > INITIAL_MASS_VARIANCE + INITIAL_DELAY_VARIANCE) ? 1.0f : FORGETTING_FACTOR;
+
+    float px0 = p[0][0] * x0 + p[0][1] * x1;
+    float px1 = p[1][0] * x0 + p[1][1] * x1;
+    float denominator = lambda + x0 * px0 + x1 * px1;
+
+    float gain0 = px0 / denominator;
+    float gain1 = px1 / denominator;
+
+    float residual = carry_over - (compensation->inflight_mass * x0 + compensation->delay_s * x1);
+    compensation->inflight_mass += gain0 * residual;
+    compensation->delay_s += gain1 * residual;
+
+    // P = (P - K x' P) / lambda
+    float p00 = (p[0][0] - gain0 * px0) / lambda;
+    float p01 = (p[0][1] - gain0 * px1) / lambda;
+    float p11 = (p[1][1] - gain1 * px1) / lambda;
+    p[0][0] = p00;
+    p[0][1] = p01;
+    p[1][0] = p01;
+    p[1][1] = p11;
+
+    compensation->delay_s = fminf(fmaxf(compensation->delay_s, 0.0f), INFLIGHT_COMPENSATION_MAX_DELAY_MS / 1000.0f);
+    compensation->drop_count += 1;
+
+    return true;
+}
+
+
+float inflight_compensation_get_delay_ms(const inflight_compensation_t * compensation) {
+    return compensation->delay_s * 1000.0f;
+}
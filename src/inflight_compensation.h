@@ -0,0 +1,89 @@
+#ifndef INFLIGHT_COMPENSATION_H_
+#define INFLIGHT_COMPENSATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Predictive in-flight compensation for the trickler stop
+ *
+ * When the motors stop, the powder already falling and the powder the scale
+ * hasn't shown yet (filter lag) still land on the reading. This carry-over is
+ * modelled as
+ *
+ *     carry_over = inflight_mass + flow_rate * delay
+ *
+ * where flow_rate is the rate the reading was rising at when the motors
+ * stopped. inflight_mass and delay are learned with recursive least squares
+ * from the settled final weight against the reading at the stop, so the model
+ * follows the powder, the trickler speed and the scale of each profile.
+ *
+ * It pays off when the fine trickler still flows at the stop, e.g. a slow
+ * scale (charge_mode_sim --fall-ms 300 --latency-ms 300 --inflight 1) or a
+ * coarse fine trickler (--fine-gpr 0.5). With the default plant the PID has
+ * crawled to a carry-over under the scale resolution and nothing changes.
+ *
+ * Usage:
+ * 1. inflight_compensation_init() with the learned values of the profile
+ * 2. inflight_compensation_reset_flow() when the charge starts and
+ *    inflight_compensation_update_flow() with every measurement
+ * 3. Stop the motors once the error is below inflight_compensation_predict()
+ *    and call inflight_compensation_mark_stop()
+ * 4. Once the scale has settled, inflight_compensation_learn() with the final
+ *    weight
+ */
+
+#define INFLIGHT_COMPENSATION_FLOW_WINDOW       5           // Samples the flow rate is measured across
+#define INFLIGHT_COMPENSATION_MIN_DROPS         3           // Drops to learn from before the prediction is used
+#define INFLIGHT_COMPENSATION_MAX_DELAY_MS      2000.0f
+
+typedef struct {
+    // Learned model, theta = [inflight_mass, delay_s]
+    float inflight_mass;
+    float delay_s;
+    float covariance[2][2];
+    uint32_t drop_count;
+
+    // Flow rate from the readings over the last INFLIGHT_COMPENSATION_FLOW_WINDOW samples, in weight per second
+    float weight_history[INFLIGHT_COMPENSATION_FLOW_WINDOW];
+    uint32_t tick_us_history[INFLIGHT_COMPENSATION_FLOW_WINDOW];
+    uint8_t history_len;
+    uint8_t history_idx;
+    float flow_rate;
+    float frame_interval_s;
+
+    // Observation taken at the stop, consumed by inflight_compensation_learn()
+    bool is_stop_marked;
+    float weight_at_stop;
+    float flow_rate_at_stop;
+} inflight_compensation_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A profile that has never learned anything has both values at 0
+void inflight_compensation_init(inflight_compensation_t * compensation, float inflight_mass, float delay_ms);
+
+void inflight_compensation_reset_flow(inflight_compensation_t * compensation);
+void inflight_compensation_update_flow(inflight_compensation_t * compensation, float weight, uint32_t tick_us);
+
+// True once enough drops have been learned for the prediction to be trusted
+bool inflight_compensation_is_ready(const inflight_compensation_t * compensation);
+
+// Weight still to land if the motors were stopped now, plus half a frame of flow for the frame granularity
+float inflight_compensation_predict(const inflight_compensation_t * compensation);
+
+void inflight_compensation_mark_stop(inflight_compensation_t * compensation, float weight_at_stop);
+
+// Update the model with the settled weight of the drop. Returns false if no stop was marked.
+bool inflight_compensation_learn(inflight_compensation_t * compensation, float final_weight);
+
+float inflight_compensation_get_delay_ms(const inflight_compensation_t * compensation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // INFLIGHT_COMPENSATION_H_
@@ -34,6 +34,8 @@ typedef struct {
 #define MOTOR_MAX_GEAR_RATIO        10.0f
 #define MOTOR_MIN_RSENSE            10
 #define MOTOR_MAX_RSENSE            500
+#define MOTOR_MIN_STALL_THRESHOLD   0
+#define MOTOR_MAX_STALL_THRESHOLD   510         // SG_RESULT full scale
 
 // Charge mode validation constants
 #define CHARGE_MIN_THRESHOLD        0.001f
@@ -44,6 +46,8 @@ typedef struct {
 #define CHARGE_MAX_PRECHARGE_TIME   60000
 #define CHARGE_MIN_TARGET_WEIGHT    0.0f
 #define CHARGE_MAX_TARGET_WEIGHT    10000.0f
+#define CHARGE_MIN_BATCH_REPETITIONS    1
+#define CHARGE_MAX_BATCH_REPETITIONS    1000    // CHARGE_SESSION_MAX_REPETITIONS
 
 // Servo validation constants
 #define SERVO_MIN_DUTY_CYCLE_FRAC   0.0f
@@ -69,12 +73,22 @@ typedef struct {
 #define PROFILE_MAX_INDEX           7
 #define PROFILE_NAME_MIN_LEN        1
 #define PROFILE_NAME_MAX_LEN        16
+#define PROFILE_MIN_INFLIGHT_MASS   -10.0f
+#define PROFILE_MAX_INFLIGHT_MASS   10.0f
+#define PROFILE_MIN_INFLIGHT_DELAY  0.0f
+#define PROFILE_MAX_INFLIGHT_DELAY  2000.0f     // INFLIGHT_COMPENSATION_MAX_DELAY_MS
+#define PROFILE_MIN_WEIGHT_PER_REV  0.0f
+#define PROFILE_MAX_WEIGHT_PER_REV  1000.0f
+#define PROFILE_MIN_BACKOFF_ANGLE   0.0f
+#define PROFILE_MAX_BACKOFF_ANGLE   360.0f
+#define PROFILE_MIN_BACKOFF_SPEED   0.1f
+#define PROFILE_MAX_BACKOFF_SPEED   MOTOR_MAX_SPEED_RPS
 
 // Scale configuration validation constants
 #define SCALE_MIN_DRIVER_INDEX      0
 #define SCALE_MAX_DRIVER_INDEX      6   // 7 scale drivers (0-6)
 #define SCALE_MIN_BAUDRATE_INDEX    0
-#define SCALE_MAX_BAUDRATE_INDEX    2   // 3 baudrates (0-2)
+#define SCALE_MAX_BAUDRATE_INDEX    3   // 4 baudrates (0-3)
 
 // Neopixel LED validation constants
 #define NEOPIXEL_MIN_CHAIN_COUNT    0
@@ -164,6 +178,12 @@ static inline validation_result_t validate_rsense(uint16_t value) {
     return VALIDATION_OK;
 }
 
+static inline validation_result_t validate_stall_threshold(int value) {
+    if (!is_in_range_int(value, MOTOR_MIN_STALL_THRESHOLD, MOTOR_MAX_STALL_THRESHOLD))
+        return VALIDATION_ERROR("Stall threshold out of range (0-510)");
+    return VALIDATION_OK;
+}
+
 static inline validation_result_t validate_full_steps(uint32_t value) {
     // Common stepper motor values: 200 (1.8°) or 400 (0.9°)
     if (value != 200 && value != 400)
@@ -202,6 +222,12 @@ static inline validation_result_t validate_target_weight(float value) {
     return VALIDATION_OK;
 }
 
+static inline validation_result_t validate_batch_repetitions(int value) {
+    if (!is_in_range_int(value, CHARGE_MIN_BATCH_REPETITIONS, CHARGE_MAX_BATCH_REPETITIONS))
+        return VALIDATION_ERROR("Batch repetitions out of range (1-1000)");
+    return VALIDATION_OK;
+}
+
 // Cleanup mode validation
 static inline validation_result_t validate_cleanup_speed(float value) {
     if (!is_valid_float(value))
@@ -261,6 +287,46 @@ static inline validation_result_t validate_flow_speed(float value) {
     return VALIDATION_OK;
 }
 
+static inline validation_result_t validate_inflight_mass(float value) {
+    if (!is_valid_float(value))
+        return VALIDATION_ERROR("Invalid in-flight mass (NaN/Inf)");
+    if (!is_in_range_float(value, PROFILE_MIN_INFLIGHT_MASS, PROFILE_MAX_INFLIGHT_MASS))
+        return VALIDATION_ERROR("In-flight mass out of range (-10.0-10.0)");
+    return VALIDATION_OK;
+}
+
+static inline validation_result_t validate_inflight_delay_ms(float value) {
+    if (!is_valid_float(value))
+        return VALIDATION_ERROR("Invalid in-flight delay (NaN/Inf)");
+    if (!is_in_range_float(value, PROFILE_MIN_INFLIGHT_DELAY, PROFILE_MAX_INFLIGHT_DELAY))
+        return VALIDATION_ERROR("In-flight delay out of range (0-2000 ms)");
+    return VALIDATION_OK;
+}
+
+static inline validation_result_t validate_weight_per_rev(float value) {
+    if (!is_valid_float(value))
+        return VALIDATION_ERROR("Invalid weight per revolution (NaN/Inf)");
+    if (!is_in_range_float(value, PROFILE_MIN_WEIGHT_PER_REV, PROFILE_MAX_WEIGHT_PER_REV))
+        return VALIDATION_ERROR("Weight per revolution out of range (0.0-1000.0)");
+    return VALIDATION_OK;
+}
+
+static inline validation_result_t validate_backoff_angle(float value) {
+    if (!is_valid_float(value))
+        return VALIDATION_ERROR("Invalid back-off angle (NaN/Inf)");
+    if (!is_in_range_float(value, PROFILE_MIN_BACKOFF_ANGLE, PROFILE_MAX_BACKOFF_ANGLE))
+        return VALIDATION_ERROR("Back-off angle out of range (0-360 degrees)");
+    return VALIDATION_OK;
+}
+
+static inline validation_result_t validate_backoff_speed(float value) {
+    if (!is_valid_float(value))
+        return VALIDATION_ERROR("Invalid back-off speed (NaN/Inf)");
+    if (!is_in_range_float(value, PROFILE_MIN_BACKOFF_SPEED, PROFILE_MAX_BACKOFF_SPEED))
+        return VALIDATION_ERROR("Back-off speed out of range (0.1-50.0 rps)");
+    return VALIDATION_OK;
+}
+
 static inline validation_result_t validate_profile_index(uint8_t value) {
     if (value > PROFILE_MAX_INDEX)
         return VALIDATION_ERROR("Profile index out of range (0-7)");
@@ -276,7 +342,7 @@ static inline validation_result_t validate_scale_driver(int value) {
 
 static inline validation_result_t validate_scale_baudrate(int value) {
     if (!is_in_range_int(value, SCALE_MIN_BAUDRATE_INDEX, SCALE_MAX_BAUDRATE_INDEX))
-        return VALIDATION_ERROR("Scale baudrate out of range (0-2)");
+        return VALIDATION_ERROR("Scale baudrate out of range (0-3)");
     return VALIDATION_OK;
 }
 
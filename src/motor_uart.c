@@ -0,0 +1,284 @@
+// Interrupt driven transport for the single wire UART shared by the TMC2209 stepper drivers.
+//
+// Datagrams are queued to the motor UART task, which puts them on the wire one at a time. The RX interrupt
+// drains the hardware FIFO into a ring and wakes the task, so no core spins while a reply is in flight. The
+// single wire bus echoes every byte sent. A reply is told apart from the echo by the master address that only
+// the drivers send, and is only accepted with a valid CRC.
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <string.h>
+
+#include "hardware/uart.h"
+#include "hardware/irq.h"
+#include "pico/time.h"
+#include "configuration.h"
+#include "motor_uart.h"
+
+
+#define MOTOR_UART_RX_BUFFER_MASK           (MOTOR_UART_RX_BUFFER_LEN - 1)
+#define TMC_UART_SYNC                       0x05
+#define TMC_UART_MASTER_ADDR                0xFF
+
+
+typedef struct {
+    uint8_t datagram[MOTOR_UART_MAX_DATAGRAM_LEN];
+    uint8_t len;
+
+    // Read requests only, the requester waits on its task notification until the reply is in
+    uint8_t * reply;
+    uint8_t reply_len;
+    TaskHandle_t requester;
+    bool * is_ok;
+
+    // Synced writes only
+    motor_uart_sent_callback_t on_sent;
+    void * on_sent_param;
+} motor_uart_request_t;
+
+
+// Single producer (IRQ), single consumer (whoever owns the bus)
+static uint8_t rx_buffer[MOTOR_UART_RX_BUFFER_LEN];
+static volatile uint32_t rx_head = 0;
+static uint32_t rx_tail = 0;
+
+static QueueHandle_t request_queue = NULL;
+static TaskHandle_t motor_uart_task_handle = NULL;
+
+
+void swuart_calcCRC(uint8_t* datagram, uint8_t datagramLength)
+{
+    int i,j;
+    uint8_t* crc = datagram + (datagramLength-1); // CRC located in last byte of message
+    uint8_t currentByte;
+    *crc = 0;
+    for (i=0; i<(datagramLength-1); i++) { // Execute for all bytes of a message
+        currentByte = datagram[i]; // Retrieve a byte to be sent from Array
+        for (j=0; j<8; j++) {
+            if ((*crc >> 7) ^ (currentByte&0x01)) // update CRC based result of XOR operation
+            {
+                *crc = (*crc << 1) ^ 0x07;
+            }
+            else
+            {
+                *crc = (*crc << 1);
+            }
+            currentByte = currentByte >> 1;
+        } // for CRC bit
+    } // for message byte
+}
+
+
+static void _motor_uart_irq_handler(void) {
+    uint32_t head = rx_head;
+
+    // Only the latest reply matters, on overflow the consumer skips to the newest bytes
+    while (uart_is_readable(MOTOR_UART)) {
+        rx_buffer[head & MOTOR_UART_RX_BUFFER_MASK] = (uint8_t) (uart_get_hw(MOTOR_UART)->dr & 0xFF);
+        head += 1;
+    }
+
+    __atomic_store_n(&rx_head, head, __ATOMIC_RELEASE);
+
+    if (motor_uart_task_handle && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(motor_uart_task_handle, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+}
+
+
+// Look for a driver reply among the received bytes, skipping echoes and noise
+static bool _motor_uart_find_reply(uint8_t * reply, size_t reply_len) {
+    uint32_t head = __atomic_load_n(&rx_head, __ATOMIC_ACQUIRE);
+
+    if (head - rx_tail > MOTOR_UART_RX_BUFFER_LEN) {
+        rx_tail = head - MOTOR_UART_RX_BUFFER_LEN;
+    }
+
+    while (head - rx_tail >= reply_len) {
+        if (rx_buffer[rx_tail & MOTOR_UART_RX_BUFFER_MASK] == TMC_UART_SYNC &&
+            rx_buffer[(rx_tail + 1) & MOTOR_UART_RX_BUFFER_MASK] == TMC_UART_MASTER_ADDR) {
+            for (size_t idx = 0; idx < reply_len; idx++) {
+                reply[idx] = rx_buffer[(rx_tail + idx) & MOTOR_UART_RX_BUFFER_MASK];
+            }
+
+            uint8_t crc = reply[reply_len - 1];
+            swuart_calcCRC(reply, reply_len);
+            if (crc == reply[reply_len - 1]) {
+                rx_tail += reply_len;
+                return true;
+            }
+        }
+
+        rx_tail += 1;
+    }
+
+    return false;
+}
+
+
+// Put one datagram on the wire and collect the reply, if any. The RTOS variant sleeps until the RX interrupt
+// has something, before the scheduler starts the reply is polled.
+static bool _motor_uart_exchange(const motor_uart_request_t * request, bool is_rtos) {
+    const uint8_t * datagram = request->datagram;
+    size_t len = request->len;
+    uint8_t * reply = request->reply;
+    size_t reply_len = request->reply_len;
+
+    // Drop the echo of the previous datagram and anything stale
+    rx_tail = __atomic_load_n(&rx_head, __ATOMIC_ACQUIRE);
+
+    // A datagram fits in the TX FIFO, this doesn't wait for the transmission
+    uart_write_blocking(MOTOR_UART, datagram, len);
+
+    if (request->on_sent) {
+        // The driver acts on a write once the last stop bit is in, which is when the UART stops being busy
+        taskENTER_CRITICAL();
+        uart_tx_wait_blocking(MOTOR_UART);
+        request->on_sent(request->on_sent_param);
+        taskEXIT_CRITICAL();
+    }
+
+    if (!reply) {
+        return true;
+    }
+
+    if (is_rtos) {
+        TickType_t start_tick = xTaskGetTickCount();
+        TickType_t timeout_ticks = pdMS_TO_TICKS(MOTOR_UART_TIMEOUT_MS);
+
+        while (!_motor_uart_find_reply(reply, reply_len)) {
+            TickType_t elapsed_ticks = xTaskGetTickCount() - start_tick;
+            if (elapsed_ticks >= timeout_ticks) {
+                return false;
+            }
+            ulTaskNotifyTake(pdTRUE, timeout_ticks - elapsed_ticks);
+        }
+    }
+    else {
+        uint32_t start_us = time_us_32();
+
+        while (!_motor_uart_find_reply(reply, reply_len)) {
+            if (time_us_32() - start_us > MOTOR_UART_TIMEOUT_MS * 1000) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+static void motor_uart_task(void * p) {
+    motor_uart_request_t request;
+
+    while (true) {
+        xQueueReceive(request_queue, &request, portMAX_DELAY);
+
+        bool is_ok = _motor_uart_exchange(&request, true);
+
+        if (request.requester) {
+            *request.is_ok = is_ok;
+            xTaskNotifyGive(request.requester);
+        }
+    }
+}
+
+
+void motor_uart_init(void) {
+    // Keep the receiver on all the time, the echo is filtered out in software
+    hw_set_bits(&uart_get_hw(MOTOR_UART)->cr, UART_UARTCR_RXE_BITS);
+    uart_set_fifo_enabled(MOTOR_UART, true);
+
+    uint irq_num = uart_get_index(MOTOR_UART) == 0 ? UART0_IRQ : UART1_IRQ;
+    irq_set_exclusive_handler(irq_num, _motor_uart_irq_handler);
+    irq_set_enabled(irq_num, true);
+
+    // Fires at the lowest FIFO level (4 bytes) or on receive timeout, whichever comes first
+    uart_set_irq_enables(MOTOR_UART, true, false);
+
+    request_queue = xQueueCreate(MOTOR_UART_REQUEST_QUEUE_LEN, sizeof(motor_uart_request_t));
+    xTaskCreate(motor_uart_task, "Motor UART", configMINIMAL_STACK_SIZE, NULL, 7, &motor_uart_task_handle);
+}
+
+
+bool motor_uart_send(const uint8_t * datagram, size_t len) {
+    if (len > MOTOR_UART_MAX_DATAGRAM_LEN) {
+        return false;
+    }
+
+    motor_uart_request_t request = {
+        .len = len,
+        .reply = NULL,
+        .requester = NULL,
+        .on_sent = NULL,
+    };
+    memcpy(request.datagram, datagram, len);
+
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return _motor_uart_exchange(&request, false);
+    }
+
+    return xQueueSend(request_queue, &request, portMAX_DELAY) == pdTRUE;
+}
+
+
+bool motor_uart_send_synced(const uint8_t * datagram, size_t len, motor_uart_sent_callback_t on_sent, void * param) {
+    if (len > MOTOR_UART_MAX_DATAGRAM_LEN) {
+        return false;
+    }
+
+    bool is_ok = false;
+    motor_uart_request_t request = {
+        .len = len,
+        .reply = NULL,
+        .requester = NULL,
+        .is_ok = &is_ok,
+        .on_sent = on_sent,
+        .on_sent_param = param,
+    };
+    memcpy(request.datagram, datagram, len);
+
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return _motor_uart_exchange(&request, false);
+    }
+
+    request.requester = xTaskGetCurrentTaskHandle();
+    xQueueSend(request_queue, &request, portMAX_DELAY);
+
+    // Answered once the datagram is out and on_sent has run
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return is_ok;
+}
+
+
+bool motor_uart_transfer(const uint8_t * request_datagram, size_t request_len, uint8_t * reply, size_t reply_len) {
+    if (request_len > MOTOR_UART_MAX_DATAGRAM_LEN) {
+        return false;
+    }
+
+    bool is_ok = false;
+    motor_uart_request_t request = {
+        .len = request_len,
+        .reply = reply,
+        .reply_len = reply_len,
+        .requester = NULL,
+        .is_ok = &is_ok,
+        .on_sent = NULL,
+    };
+    memcpy(request.datagram, request_datagram, request_len);
+
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return _motor_uart_exchange(&request, false);
+    }
+
+    request.requester = xTaskGetCurrentTaskHandle();
+    xQueueSend(request_queue, &request, portMAX_DELAY);
+
+    // The motor UART task always answers, the exchange has its own timeout
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return is_ok;
+}
@@ -0,0 +1,44 @@
+#ifndef MOTOR_UART_H_
+#define MOTOR_UART_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MOTOR_UART_RX_BUFFER_LEN                64             // Must be power of two
+#define MOTOR_UART_MAX_DATAGRAM_LEN             8
+#define MOTOR_UART_REQUEST_QUEUE_LEN            8
+#define MOTOR_UART_TIMEOUT_MS                   5              // A read reply arrives within about 1 ms at 250k baud
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Called by the motor UART task the moment a datagram is out on the wire, in a critical section
+typedef void (*motor_uart_sent_callback_t)(void * param);
+
+
+// Install the RX interrupt and start the transport task. Must be called after uart_init().
+void motor_uart_init(void);
+
+// Queue a write datagram and return right away. The datagram is copied.
+bool motor_uart_send(const uint8_t * datagram, size_t len);
+
+// Send a write datagram and wait until it is out. on_sent is called right after the last stop bit, when the
+// driver takes the new value, so the caller can act in step with it. Once the scheduler is running this uses the
+// task notification of the caller.
+bool motor_uart_send_synced(const uint8_t * datagram, size_t len, motor_uart_sent_callback_t on_sent, void * param);
+
+// Send a read request and wait for the reply with a valid CRC. Returns false on timeout. Once the scheduler is
+// running this uses the task notification of the caller.
+bool motor_uart_transfer(const uint8_t * request, size_t request_len, uint8_t * reply, size_t reply_len);
+
+// CRC8 from the TMC2209 datasheet, calculated over all but the last byte which receives the CRC
+void swuart_calcCRC(uint8_t* datagram, uint8_t datagramLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // MOTOR_UART_H_
@@ -1,6 +1,7 @@
 /* Isolate the C and C++ */
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <FreeRTOS.h>
 #include <queue.h>
@@ -11,10 +12,13 @@
 #include "configuration.h"
 #include "hardware/gpio.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 #include "hardware/clocks.h"
 #include "stepper.pio.h"
 
 #include "motors.h"
+#include "motor_uart.h"
 #include "eeprom.h"
 #include "common.h"
 #include "display.h"  // in case the stepper motor driver failed to initialize
@@ -23,14 +27,18 @@
 
 #define STEPPER_LOW_CYCLE_COUNT 13  // Defined as the implementation of stepper.pio
 #define MAX_RESPONSE_TIME   0.01f   // Maximum response time for PIO stepper
+#define RAMP_WAIT_TIMEOUT_MS    100 // Fallback in case a ramp DMA interrupt is missed
+#define RAMP_EXACT_STEPS        16  // Steps from standstill where the period recurrence is too coarse
+#define MOTOR_MICROSTEP_READ_ATTEMPTS   3   // Read backs of the new resolution before it is given up
 
-
-// Internal data structure for speed control between tasks
-typedef struct {
-    float new_speed_setpoint;
-    float direction;
-    float ramp_rate;
-} stepper_speed_control_t;
+// CoolStep settings, the current is raised quickly as soon as the load increases and lowered slowly
+#define COOLSTEP_SEMIN      5       // Raise the current when SG_RESULT falls below SEMIN * 32
+#define COOLSTEP_SEMAX      2       // Lower the current when SG_RESULT rises above (SEMIN + SEMAX + 1) * 32
+#define COOLSTEP_SEUP       1       // Raise by 2 current steps at a time
+#define COOLSTEP_SEDN       0       // Lower by 1 current step every 32 StallGuard readings
+#define COOLSTEP_SEIMIN     1       // Never go below 1/4 of the run current
+#define TCOOLTHRS_MAX       0xFFFFF // TCOOLTHRS is 20 bit
+#define TMC_FCLK_HZ         12000000 // Internal clock of the driver, TSTEP and TCOOLTHRS count its cycles
 
 
 // Configurations
@@ -51,115 +59,63 @@ const motor_persistent_config_t default_motor_persistent_config = {
 
     .inverted_direction = false,        // Invert the direction if set to true
     .inverted_enable = false,           // Invert the enable flag if set to true
+
+    .coolstep_enabled = false,          // Run at the fixed current
+    .stall_threshold = 0,               // No jam detection
 };
 
 
 
-// UART Control functions
-void _enable_uart_rx(uart_inst_t * uart, bool enable) {
-    if (enable) {
-        hw_set_bits(&uart_get_hw(uart)->cr, UART_UARTCR_RXE_BITS);
-    }
-    else {
-        hw_clear_bits(&uart_get_hw(uart)->cr, UART_UARTCR_RXE_BITS);
-    }
-}
+static void motor_microsteps_sent(void * param);
 
 
-void _clear_rx_buffer(uart_inst_t * uart) {
-    while(!(uart_get_hw(uart)->fr & UART_UARTFR_RXFE_BITS)) {
-        uart_get_hw(uart)->dr;
+static motor_config_t * motor_config_for_address(uint8_t address) {
+    if (coarse_trickler_motor_config.uart_addr == address) {
+        return &coarse_trickler_motor_config;
+    }
+    if (fine_trickler_motor_config.uart_addr == address) {
+        return &fine_trickler_motor_config;
     }
-}
-
-
-bool _block_wait_for_sync(uart_inst_t * uart) {
-    uint8_t c;
-    do
-    {
-        if (uart_is_readable_within_us(uart, 2000)) {
-            uart_read_blocking(MOTOR_UART, &c, 1);
-        }
-        else {
-            return false;
-        }
-    } while (c != 0x05); 
-
-    return true;
-}
-
 
-void swuart_calcCRC(uint8_t* datagram, uint8_t datagramLength)
-{
-    int i,j;
-    uint8_t* crc = datagram + (datagramLength-1); // CRC located in last byte of message
-    uint8_t currentByte;
-    *crc = 0;
-    for (i=0; i<(datagramLength-1); i++) { // Execute for all bytes of a message
-        currentByte = datagram[i]; // Retrieve a byte to be sent from Array
-        for (j=0; j<8; j++) {
-            if ((*crc >> 7) ^ (currentByte&0x01)) // update CRC based result of XOR operation
-            {
-                *crc = (*crc << 1) ^ 0x07;
-            }
-            else
-            {
-                *crc = (*crc << 1);
-            }
-            currentByte = currentByte >> 1;
-        } // for CRC bit
-    } // for message byte
+    return NULL;
 }
 
 
-
 void tmc_uart_write (trinamic_motor_t driver, TMC_uart_write_datagram_t *datagram)
 {
-    uart_write_blocking(MOTOR_UART, datagram->data, sizeof(TMC_uart_write_datagram_t));
+    // A resolution change waits until it is out on the wire and hands over the step period in the same instant
+    motor_config_t * motor_config = motor_config_for_address(driver.address);
+    if (motor_config && motor_config->pending_microsteps) {
+        motor_uart_send_synced(datagram->data, sizeof(TMC_uart_write_datagram_t), motor_microsteps_sent, motor_config);
+        return;
+    }
+
+    // Queued to the motor UART task, the caller doesn't wait for the transmission
+    motor_uart_send(datagram->data, sizeof(TMC_uart_write_datagram_t));
 }
 
 TMC_uart_write_datagram_t *tmc_uart_read (trinamic_motor_t driver, TMC_uart_read_datagram_t *datagram)
 {
     static TMC_uart_write_datagram_t wdgr = {0}; 
 
-    uart_write_blocking(MOTOR_UART, datagram->data, sizeof(TMC_uart_read_datagram_t));
-
-    // At 250k baud rate the transmit time is about 320us. Need to wait long enough to not reading the echo message back.
-    busy_wait_us(20);
-    _enable_uart_rx(MOTOR_UART, true);
-    busy_wait_ms(2);
-    
-    uint8_t sync_flag = 0x05;
-    int8_t idx = -1;
-    while (uart_is_readable_within_us(MOTOR_UART, 2000)) {
-        uint8_t c;
-
-        uart_read_blocking(MOTOR_UART, &c, 1);
-        if (c == sync_flag) {
-            idx = 0;
-        }
-
-        if (idx >= 0 && idx < 8) {
-            wdgr.data[idx++] = c;
-        }
-
-        if (idx == 8) {
-            // FIXME: there is known issue that calling IFCNT causes target addr to be incorrect. 
-            // Calculate CRC
-            uint8_t crc = wdgr.msg.crc;
-            swuart_calcCRC(wdgr.data, sizeof(TMC_uart_write_datagram_t));
-            if (crc == wdgr.msg.crc) {
-                break;
-            }
-            idx = -1;
-        }
+    // FIXME: there is known issue that calling IFCNT causes target addr to be incorrect. 
+    bool is_ok = motor_uart_transfer(datagram->data, sizeof(TMC_uart_read_datagram_t), 
+                                     wdgr.data, sizeof(TMC_uart_write_datagram_t));
+    if (!is_ok) {
+        // Make sure the library rejects the reply on its CRC check
+        memset(wdgr.data, 0, sizeof(TMC_uart_write_datagram_t));
+        wdgr.msg.crc = 0xFF;
     }
 
-    _enable_uart_rx(MOTOR_UART, false);
-
     return &wdgr;
 }
 
+// True if the DIR pin is set for positive velocity
+static inline bool motor_is_forward(motor_config_t * motor_config) {
+    return motor_config->step_direction == motor_config->persistent_config.inverted_direction;
+}
+
+
 uint32_t speed_to_period(float speed, uint32_t pio_clock_speed, uint32_t full_rotation_steps) {
     // speed: rev/s
     float step_speed = full_rotation_steps * speed;    // in steps/s
@@ -258,6 +214,7 @@ bool driver_init(motor_config_t * motor_config) {
     tmc_driver->config.r_sense = motor_config->persistent_config.r_sense;
     tmc_driver->config.hold_current_pct = 50;
     tmc_driver->config.microsteps = motor_config->persistent_config.microsteps;
+    motor_config->active_microsteps = motor_config->persistent_config.microsteps;
 
     bool is_ok = tmc2209_init(tmc_driver);
 
@@ -317,10 +274,53 @@ bool driver_pio_init(motor_config_t * motor_config) {
     motor_config->pio_config.pio = pio;
     motor_config->pio_config.sm = sm;
 
+    // The speed ramp is fed to the state machine by DMA, the channels are configured for each ramp
+    for (uint idx = 0; idx < 2; idx++) {
+        motor_config->ramp_dma_channel[idx] = dma_claim_unused_channel(true);
+        dma_channel_set_irq0_enabled(motor_config->ramp_dma_channel[idx], true);
+    }
+
+    // A second state machine counts the steps actually issued
+    is_ok = pio_claim_free_sm_and_add_program_for_gpio_range(
+        &step_counter_program, 
+        &pio, 
+        &sm, 
+        &offset, 
+        motor_config->step_pin, 
+        1, 
+        true
+    );
+
+    if (!is_ok) {
+        printf("Unable to claim PIO for step counter\n");
+        return false;
+    }
+
+    step_counter_program_init(pio, sm, offset, motor_config->step_pin);
+    pio_sm_set_enabled(pio, sm, true);
+
+    motor_config->step_counter_pio_config.pio = pio;
+    motor_config->step_counter_pio_config.sm = sm;
+
     return true;
 }
 
 
+// Steps issued since the counter started, wraps around at 32 bit. Must be called in a critical section as the
+// state machine is shared by all readers.
+static uint32_t step_counter_read(motor_config_t * motor_config) {
+    PIO pio = motor_config->step_counter_pio_config.pio;
+    uint sm = motor_config->step_counter_pio_config.sm;
+
+    // Forced instructions run in between the waits, the counter doesn't miss an edge
+    pio_sm_exec(pio, sm, pio_encode_mov(pio_isr, pio_x));
+    pio_sm_exec(pio, sm, pio_encode_push(false, false));
+
+    // X counts down
+    return -pio_sm_get_blocking(pio, sm);
+}
+
+
 bool motor_config_init(void) {
     bool is_ok = true;
 
@@ -387,80 +387,419 @@ bool motor_config_save() {
 }
 
 
-void speed_ramp(motor_config_t * motor_config, float prev_speed, float new_speed, uint32_t pio_speed) {
-    // Calculate ramp param
-    float dv = new_speed - prev_speed;
-    float ramp_time_s = fabs(dv / motor_config->persistent_config.angular_acceleration);
-    uint32_t full_rotation_steps = motor_config->persistent_config.full_steps_per_rotation * motor_config->persistent_config.microsteps;
+// Per step state of a constant acceleration ramp. The step period follows the recurrence from D. Austin,
+// "Generate stepper-motor speed profiles in real time", which only takes one integer division per step. It is
+// seeded with the exact period at the start of every table and for the first few steps from standstill, so
+// the error doesn't build up.
+typedef struct {
+    uint32_t n;                 // Steps it takes to accelerate from standstill to the current speed
+    uint32_t end_n;
+    uint32_t period_q8;         // Period of the next step in 1/256 PIO cycles
+    float period_scale_q8;      // Period of the first step from standstill in 1/256 PIO cycles
+    uint32_t final_period;      // Queued once the ramp is done, as returned by speed_to_period()
+    bool is_accelerating;
+    bool is_landed;
+} motor_ramp_t;
+
+
+// The step from n to n + 1 takes sqrt(2 / a) * (sqrt(n + 1) - sqrt(n)), written without the cancellation
+static void ramp_seed_period(motor_ramp_t * ramp) {
+    uint32_t step_idx = ramp->is_accelerating ? ramp->n : ramp->n - 1;
+    ramp->period_q8 = (uint32_t) (ramp->period_scale_q8 / (sqrtf(step_idx + 1) + sqrtf(step_idx)));
+}
+
+
+// Fill a table with the next step periods of the ramp. Returns the number of periods, 0 once the final period
+// has been queued.
+static uint32_t ramp_fill_table(motor_ramp_t * ramp, uint32_t * table) {
+    uint32_t len = 0;
+
+    if (ramp->n != ramp->end_n) {
+        ramp_seed_period(ramp);
+    }
+
+    while (len < MOTOR_RAMP_TABLE_LEN && ramp->n != ramp->end_n) {
+        // A 0 would stop the state machine
+        uint32_t full_cycle_count = ramp->period_q8 >> 8;
+        if (full_cycle_count <= STEPPER_LOW_CYCLE_COUNT) {
+            full_cycle_count = STEPPER_LOW_CYCLE_COUNT + 1;
+        }
+        table[len++] = full_cycle_count - STEPPER_LOW_CYCLE_COUNT;
+
+        if (ramp->is_accelerating) {
+            ramp->n += 1;
+            ramp->period_q8 -= 2 * ramp->period_q8 / (4 * ramp->n + 1);
+        }
+        else {
+            ramp->n -= 1;
+            if (ramp->n > 0) {
+                ramp->period_q8 += 2 * ramp->period_q8 / (4 * ramp->n - 1);
+            }
+        }
+
+        if (ramp->n < RAMP_EXACT_STEPS && ramp->n != ramp->end_n) {
+            ramp_seed_period(ramp);
+        }
+    }
+
+    if (len < MOTOR_RAMP_TABLE_LEN && !ramp->is_landed) {
+        table[len++] = ramp->final_period;
+        ramp->is_landed = true;
+    }
 
-    // Calculate termination condition
-    uint32_t ramp_time_us = (uint32_t) (fabs(ramp_time_s) * 1e6);
-    uint32_t start_time = time_us_32();
-    uint32_t stop_time = start_time + ramp_time_us;
+    return len;
+}
+
+
+// Set up a channel to stream one table, paced by the TX FIFO. It isn't chained, see ramp_dma_link(). Only called
+// while the channel is idle.
+static void ramp_dma_arm(motor_config_t * motor_config, uint idx, uint32_t len) {
+    PIO pio = motor_config->pio_config.pio;
+    uint sm = motor_config->pio_config.sm;
+    int channel = motor_config->ramp_dma_channel[idx];
+
+    dma_channel_config dma_config = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_config, true);
+    channel_config_set_write_increment(&dma_config, false);
+    channel_config_set_dreq(&dma_config, pio_get_dreq(pio, sm, true));
+    channel_config_set_chain_to(&dma_config, channel);  // Chaining to itself is no chaining
+    dma_channel_configure(channel, &dma_config, &pio->txf[sm], motor_config->ramp_table[idx], len, false);
+}
+
+
+// True once the channel has been started on its table, by the chain or by hand
+static bool ramp_dma_is_started(motor_config_t * motor_config, uint idx) {
+    int channel = motor_config->ramp_dma_channel[idx];
+    return dma_channel_is_busy(channel) ||
+           dma_channel_hw_addr(channel)->read_addr != (uint32_t) (uintptr_t) motor_config->ramp_table[idx];
+}
+
+
+// Chain the running channel to the other one, which has just been armed with the next table. CTRL is written
+// through the alias that doesn't trigger. If the running channel was already done the chain came too late, the
+// PIO has been repeating the last period since and the next table is started by hand.
+static void ramp_dma_link(motor_config_t * motor_config, uint running_idx) {
+    int channel = motor_config->ramp_dma_channel[running_idx];
+    int next_channel = motor_config->ramp_dma_channel[!running_idx];
+    dma_channel_hw_t * hw = dma_channel_hw_addr(channel);
+
+    hw->al1_ctrl = (hw->al1_ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | ((uint) next_channel << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+
+    if (!dma_channel_is_busy(channel) && !ramp_dma_is_started(motor_config, !running_idx)) {
+        dma_channel_start(next_channel);
+    }
+}
+
+
+// Periods of the table handed to the PIO so far
+static uint32_t ramp_dma_num_sent(motor_config_t * motor_config, uint idx) {
+    uint32_t read_addr = dma_channel_hw_addr(motor_config->ramp_dma_channel[idx])->read_addr;
+    return (read_addr - (uint32_t) (uintptr_t) motor_config->ramp_table[idx]) / sizeof(uint32_t);
+}
+
+
+static void ramp_dma_abort(motor_config_t * motor_config) {
+    // An abort can trigger the chained channel (RP2040-E13), so disable both channels first
+    for (uint idx = 0; idx < 2; idx++) {
+        hw_clear_bits(&dma_channel_hw_addr(motor_config->ramp_dma_channel[idx])->al1_ctrl, DMA_CH0_CTRL_TRIG_EN_BITS);
+    }
+    for (uint idx = 0; idx < 2; idx++) {
+        dma_channel_abort(motor_config->ramp_dma_channel[idx]);
+        dma_channel_acknowledge_irq0(motor_config->ramp_dma_channel[idx]);
+    }
+}
+
+
+static void _ramp_dma_irq_handler(void) {
+    motor_config_t * motor_configs[] = {&coarse_trickler_motor_config, &fine_trickler_motor_config};
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    for (uint motor_idx = 0; motor_idx < 2; motor_idx++) {
+        motor_config_t * motor_config = motor_configs[motor_idx];
+        bool is_done = false;
+
+        for (uint idx = 0; idx < 2; idx++) {
+            if (dma_channel_get_irq0_status(motor_config->ramp_dma_channel[idx])) {
+                dma_channel_acknowledge_irq0(motor_config->ramp_dma_channel[idx]);
+                is_done = true;
+            }
+        }
+
+        if (is_done && motor_config->ramp_dma_semaphore) {
+            xSemaphoreGiveFromISR(motor_config->ramp_dma_semaphore, &higher_priority_task_woken);
+        }
+    }
+
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+
+// Ramp at constant acceleration (trapezoidal profile), one step at a time. The periods are computed in fixed
+// point a table ahead and DMA feeds them to the PIO as the state machine asks for them, so the timing is exact
+// to the step and the task sleeps for the duration of the ramp. The final speed is queued behind the ramp.
+//
+// The speed is ramped in the current direction. If a new setpoint arrives part way through, the ramp stops
+// where it has got to and returns true with the setpoint in next_velocity.
+bool speed_ramp(motor_config_t * motor_config, float new_speed, uint32_t pio_speed, float * next_velocity) {
+    uint32_t full_rotation_steps = motor_config->persistent_config.full_steps_per_rotation * motor_config->active_microsteps;
+    float direction = motor_is_forward(motor_config) ? 1.0f : -1.0f;
+    float step_acceleration = motor_config->persistent_config.angular_acceleration * full_rotation_steps;  // In steps/s^2
+
+    // The PIO doesn't step slower than this (see speed_to_period()), so the ramp starts and ends there
+    float min_step_rate = 1.0f / MAX_RESPONSE_TIME;
+    float start_step_rate = fmaxf(fabsf(motor_config->prev_velocity) * full_rotation_steps, min_step_rate);
+    float end_step_rate = fmaxf(new_speed * full_rotation_steps, min_step_rate);
+
+    motor_ramp_t ramp = {
+        .n = lroundf(start_step_rate * start_step_rate / (2.0f * step_acceleration)),
+        .end_n = lroundf(end_step_rate * end_step_rate / (2.0f * step_acceleration)),
+        .period_scale_q8 = pio_speed * 256.0f * sqrtf(2.0f / step_acceleration),
+        .final_period = speed_to_period(new_speed, pio_speed, full_rotation_steps),
+        .is_landed = false,
+    };
+    ramp.is_accelerating = ramp.end_n > ramp.n;
+
+    // Fill both tables, the second channel picks up as soon as the first is done
+    uint32_t table_len[2];
+    table_len[0] = ramp_fill_table(&ramp, motor_config->ramp_table[0]);
+    table_len[1] = ramp_fill_table(&ramp, motor_config->ramp_table[1]);
+
+    xSemaphoreTake(motor_config->ramp_dma_semaphore, 0);  // Drop stale wake ups
+    ramp_dma_arm(motor_config, 0, table_len[0]);
+    if (table_len[1] > 0) {
+        ramp_dma_arm(motor_config, 1, table_len[1]);
+    }
+    dma_channel_start(motor_config->ramp_dma_channel[0]);
+    if (table_len[1] > 0) {
+        ramp_dma_link(motor_config, 0);
+    }
+
+    uint active_idx = 0;
+    uint32_t last_period = 0;
+    bool has_last_period = false;
 
-    float current_speed;
-    uint32_t current_period;
     while (true) {
-        uint32_t current_time = time_us_32();
-        if (current_time > stop_time) {
+        if (xQueueReceive(motor_config->stepper_speed_control_queue, next_velocity, 0) == pdTRUE) {
+            // Retarget from the last period handed to the PIO. The few still in the FIFO run their course.
+            ramp_dma_abort(motor_config);
+
+            uint32_t num_sent = ramp_dma_num_sent(motor_config, active_idx);
+            uint32_t next_num_sent = table_len[!active_idx] > 0 ? ramp_dma_num_sent(motor_config, !active_idx) : 0;
+            if (next_num_sent > 0) {
+                last_period = motor_config->ramp_table[!active_idx][next_num_sent - 1];
+                has_last_period = true;
+            }
+            else if (num_sent > 0) {
+                last_period = motor_config->ramp_table[active_idx][num_sent - 1];
+                has_last_period = true;
+            }
+
+            if (has_last_period) {
+                float speed = last_period ? (float) pio_speed / (last_period + STEPPER_LOW_CYCLE_COUNT) / full_rotation_steps : 0.0f;
+                motor_config->prev_velocity = direction * speed;
+            }
+            return true;
+        }
+
+        if (dma_channel_is_busy(motor_config->ramp_dma_channel[active_idx])) {
+            xSemaphoreTake(motor_config->ramp_dma_semaphore, pdMS_TO_TICKS(RAMP_WAIT_TIMEOUT_MS));
+            continue;
+        }
+
+        // The active table is done and the other channel, if armed, has taken over through the chain
+        uint done_idx = active_idx;
+        last_period = motor_config->ramp_table[done_idx][table_len[done_idx] - 1];
+        has_last_period = true;
+
+        if (table_len[!done_idx] == 0) {
             break;
         }
 
-        float percentage = (current_time - start_time) / (float) ramp_time_us;
+        // The next table was linked while the done one ran, so it has been started by now
+        active_idx = !done_idx;
 
-        current_speed = prev_speed + dv * percentage;
-        current_period = speed_to_period(current_speed, pio_speed, full_rotation_steps);
-        pio_sm_clear_fifos(motor_config->pio_config.pio, motor_config->pio_config.sm);
-        pio_sm_put(motor_config->pio_config.pio, motor_config->pio_config.sm, current_period);
+        // Refill the idle channel, and only then chain the running one to it
+        table_len[done_idx] = ramp_fill_table(&ramp, motor_config->ramp_table[done_idx]);
+        if (table_len[done_idx] > 0) {
+            ramp_dma_arm(motor_config, done_idx, table_len[done_idx]);
+            ramp_dma_link(motor_config, active_idx);
+        }
     }
 
-    current_period = speed_to_period(new_speed, pio_speed, full_rotation_steps);
-    pio_sm_clear_fifos(motor_config->pio_config.pio, motor_config->pio_config.sm);
-    pio_sm_put_blocking(motor_config->pio_config.pio, motor_config->pio_config.sm, current_period);
+    motor_config->prev_velocity = direction * new_speed;
+    return false;
+}
+
+
+// Bank the steps issued since the last direction or resolution change. Must be called in a critical section.
+static void motor_bank_position(motor_config_t * motor_config) {
+    if (!motor_config->step_counter_pio_config.pio) {
+        return;
+    }
+
+    uint32_t step_count = step_counter_read(motor_config);
+    int32_t steps = (int32_t) (step_count - motor_config->position_step_count);
+    int64_t position_delta = (int64_t) steps * (MOTOR_POSITION_MICROSTEPS / motor_config->active_microsteps);
+
+    motor_config->position_steps += motor_is_forward(motor_config) ? position_delta : -position_delta;
+    motor_config->position_step_count = step_count;
+}
+
+
+// The configured resolution keeps the low speed flow smooth. At high step rates the period gets too short for
+// the PIO to resolve, so the driver is switched to MOTOR_HIGH_SPEED_MICROSTEPS instead.
+static uint16_t motor_select_microsteps(motor_config_t * motor_config, float speed) {
+    uint16_t microsteps = motor_config->persistent_config.microsteps;
+    if (microsteps <= MOTOR_HIGH_SPEED_MICROSTEPS) {
+        return microsteps;
+    }
+
+    float step_rate = speed * motor_config->persistent_config.full_steps_per_rotation * microsteps;
+    bool is_high_speed = motor_config->active_microsteps == MOTOR_HIGH_SPEED_MICROSTEPS;
+    if (is_high_speed ? step_rate > MOTOR_MICROSTEP_SWITCH_DOWN_RATE_HZ : step_rate >= MOTOR_MICROSTEP_SWITCH_UP_RATE_HZ) {
+        return MOTOR_HIGH_SPEED_MICROSTEPS;
+    }
+
+    return microsteps;
+}
+
+
+// Runs in the motor UART task the moment the driver has the new resolution. The PIO takes the new period at its
+// next step, as the ramp has left the TX FIFO empty, and the steps so far are banked at the old resolution.
+static void motor_microsteps_sent(void * param) {
+    motor_config_t * motor_config = (motor_config_t *) param;
+
+    pio_sm_put(motor_config->pio_config.pio, motor_config->pio_config.sm, motor_config->pending_period);
+
+    taskENTER_CRITICAL();
+    motor_bank_position(motor_config);
+    motor_config->active_microsteps = motor_config->pending_microsteps;
+    taskEXIT_CRITICAL();
+}
+
+
+// Write the resolution to the driver, the step period is rescaled to keep the speed in rev/s as the write lands.
+// Returns true once the read back confirms it. Must hold the driver mutex.
+static bool motor_write_microsteps(motor_config_t * motor_config, uint16_t microsteps, float speed, uint32_t pio_speed) {
+    TMC2209_t * tmc_driver = (TMC2209_t *) motor_config->tmc_driver;
+    uint32_t full_rotation_steps = motor_config->persistent_config.full_steps_per_rotation * microsteps;
+    uint8_t mres = tmc_microsteps_to_mres(microsteps);
+
+    motor_config->pending_period = speed_to_period(speed, pio_speed, full_rotation_steps);
+    motor_config->pending_microsteps = microsteps;
+
+    tmc_driver->chopconf.reg.mres = mres;
+    TMC2209_WriteRegister(tmc_driver, (TMC2209_datagram_t *)&tmc_driver->chopconf);
+
+    motor_config->pending_microsteps = 0;
+
+    for (uint attempt = 0; attempt < MOTOR_MICROSTEP_READ_ATTEMPTS; attempt++) {
+        if (TMC2209_ReadRegister(tmc_driver, (TMC2209_datagram_t *)&tmc_driver->chopconf)) {
+            return tmc_driver->chopconf.reg.mres == mres;
+        }
+    }
+
+    return false;
+}
+
+
+// Change the resolution on the fly. The motor keeps stepping throughout, the new period takes over within a
+// step of the driver taking the new resolution, so the speed in rev/s carries on unchanged.
+static void motor_switch_microsteps(motor_config_t * motor_config, uint16_t microsteps, uint32_t pio_speed) {
+    TMC2209_t * tmc_driver = (TMC2209_t *) motor_config->tmc_driver;
+    PIO pio = motor_config->pio_config.pio;
+    uint sm = motor_config->pio_config.sm;
+    uint16_t prev_microsteps = motor_config->active_microsteps;
+    float speed = fabsf(motor_config->prev_velocity);
+
+    // The last periods of the ramp are still queued, the running one has to be the one being rescaled
+    while (!pio_sm_is_tx_fifo_empty(pio, sm)) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+
+    xSemaphoreTake(motor_config->tmc_driver_mutex, portMAX_DELAY);
+
+    if (motor_write_microsteps(motor_config, microsteps, speed, pio_speed)) {
+        tmc_driver->config.microsteps = microsteps;
+    }
+    else {
+        // Whether the driver took it is unknown, write the old resolution back with the matching period
+        printf("Unable to switch to %u microsteps\n", microsteps);
+        if (!motor_write_microsteps(motor_config, prev_microsteps, speed, pio_speed)) {
+            printf("Unable to restore %u microsteps\n", prev_microsteps);
+        }
+    }
+
+    xSemaphoreGive(motor_config->tmc_driver_mutex);
+}
+
+
+// Ramp to the new speed in the current direction, switching the resolution where the speed crosses the switch
+// point. Same return as speed_ramp().
+static bool motor_ramp_to(motor_config_t * motor_config, float new_speed, uint32_t pio_speed, float * next_velocity) {
+    uint16_t microsteps = motor_select_microsteps(motor_config, new_speed);
+
+    if (microsteps != motor_config->active_microsteps) {
+        uint32_t switch_rate = microsteps < motor_config->active_microsteps ? MOTOR_MICROSTEP_SWITCH_UP_RATE_HZ : MOTOR_MICROSTEP_SWITCH_DOWN_RATE_HZ;
+        float switch_speed = (float) switch_rate / (motor_config->persistent_config.full_steps_per_rotation * motor_config->persistent_config.microsteps);
+        float prev_speed = fabsf(motor_config->prev_velocity);
+
+        // Already past the switch point, e.g. when the resolution is changed from the REST API, switches right away
+        if ((switch_speed - prev_speed) * (new_speed - switch_speed) > 0) {
+            if (speed_ramp(motor_config, switch_speed, pio_speed, next_velocity)) {
+                return true;
+            }
+        }
+
+        motor_switch_microsteps(motor_config, microsteps, pio_speed);
+    }
+
+    return speed_ramp(motor_config, new_speed, pio_speed, next_velocity);
 }
 
 
 void stepper_speed_control_task(void * p) {    
+    motor_config_t * motor_config = (motor_config_t *) p;
+    float new_velocity;
+    bool has_new_velocity = false;
+
     // Currently doing speed control
     while (true) {
-        // Wait for new speed
-        float new_velocity;
-        xQueueReceive(((motor_config_t *) p)->stepper_speed_control_queue, &new_velocity, portMAX_DELAY);
+        // Wait for new speed, unless one arrived during the last ramp
+        if (!has_new_velocity) {
+            xQueueReceive(motor_config->stepper_speed_control_queue, &new_velocity, portMAX_DELAY);
+        }
 
         // Calculate the speed of the motor
-        new_velocity /= ((motor_config_t *) p)->persistent_config.gear_ratio;
+        float target_velocity = new_velocity / motor_config->persistent_config.gear_ratio;
 
         // Get latest PIO speed, in case of the change of system clock
         uint32_t pio_speed = clock_get_hz(clk_sys);
 
         // Determine if both have same direction (no need to change DIR pin state)
-        if ((new_velocity >= 0) == (((motor_config_t *) p)->prev_velocity >= 0)) {
+        if ((target_velocity >= 0) == motor_is_forward(motor_config)) {
             // Same direction means only speed change
-            speed_ramp(((motor_config_t *) p), 
-                       fabs(((motor_config_t *) p)->prev_velocity), 
-                       fabs(new_velocity), 
-                       pio_speed);
+            has_new_velocity = motor_ramp_to(motor_config, fabsf(target_velocity), pio_speed, &new_velocity);
         }
         else {
             // Different direction, then ramp down to 0, change direction then ramp up
-            speed_ramp(((motor_config_t *) p), 
-                       fabs(((motor_config_t *) p)->prev_velocity),
-                       0.0f,
-                       pio_speed);
-            ((motor_config_t *) p)->step_direction = !((motor_config_t *) p)->step_direction;
+            has_new_velocity = motor_ramp_to(motor_config, 0.0f, pio_speed, &new_velocity);
+            if (has_new_velocity) {
+                continue;
+            }
+
+            // Toggle the direction, the steps so far are banked in the old direction
+            taskENTER_CRITICAL();
+            motor_bank_position(motor_config);
 
-            // Toggle the direction
-            gpio_put(((motor_config_t *) p)->dir_pin, ((motor_config_t *) p)->step_direction);
+            motor_config->step_direction = !motor_config->step_direction;
+            gpio_put(motor_config->dir_pin, motor_config->step_direction);
+            taskEXIT_CRITICAL();
 
             // Ramp to the new speed
-            speed_ramp(((motor_config_t *) p), 
-                       0.0f,
-                       fabs(new_velocity),
-                       pio_speed);
+            has_new_velocity = motor_ramp_to(motor_config, fabsf(target_velocity), pio_speed, &new_velocity);
         }
-
-        // Update speed
-        ((motor_config_t *) p)->prev_velocity = new_velocity;
     }
 }   
 
@@ -468,13 +807,15 @@ void stepper_speed_control_task(void * p) {
 void motor_set_speed(motor_select_t selected_motor, float new_velocity) {
     if (selected_motor == SELECT_COARSE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
         if (coarse_trickler_motor_config.stepper_speed_control_queue) {
-            xQueueSend(coarse_trickler_motor_config.stepper_speed_control_queue, &new_velocity, portMAX_DELAY);
+            xQueueOverwrite(coarse_trickler_motor_config.stepper_speed_control_queue, &new_velocity);
+            xSemaphoreGive(coarse_trickler_motor_config.ramp_dma_semaphore);  // Wake up a ramp in progress
         }
     }
 
     if (selected_motor == SELECT_FINE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
         if (fine_trickler_motor_config.stepper_speed_control_queue) {
-            xQueueSend(fine_trickler_motor_config.stepper_speed_control_queue, &new_velocity, portMAX_DELAY);
+            xQueueOverwrite(fine_trickler_motor_config.stepper_speed_control_queue, &new_velocity);
+            xSemaphoreGive(fine_trickler_motor_config.ramp_dma_semaphore);  // Wake up a ramp in progress
         }
     }
 }
@@ -552,6 +893,209 @@ float get_motor_min_speed(motor_select_t selected_motor) {
 }
 
 
+// Acceleration of the trickler in rev/s^2, the speed ramp runs at the configured motor acceleration
+float get_motor_acceleration(motor_select_t selected_motor) {
+    motor_config_t * motor_config = NULL;
+    switch (selected_motor)
+    {
+    case SELECT_COARSE_TRICKLER_MOTOR:
+        motor_config = &coarse_trickler_motor_config;
+        break;
+    case SELECT_FINE_TRICKLER_MOTOR:
+        motor_config = &fine_trickler_motor_config;
+        break;
+    
+    default:
+        assert(false);
+        break;
+    }
+
+    if (motor_config) {
+        return motor_config->persistent_config.angular_acceleration * motor_config->persistent_config.gear_ratio;
+    }
+
+    return 0.0f;
+}
+
+
+static motor_config_t * motor_get_config(motor_select_t selected_motor) {
+    switch (selected_motor)
+    {
+    case SELECT_COARSE_TRICKLER_MOTOR:
+        return &coarse_trickler_motor_config;
+    case SELECT_FINE_TRICKLER_MOTOR:
+        return &fine_trickler_motor_config;
+    
+    default:
+        assert(false);
+        break;
+    }
+
+    return NULL;
+}
+
+
+int64_t motor_get_position(motor_select_t selected_motor) {
+    motor_config_t * motor_config = motor_get_config(selected_motor);
+
+    if (!motor_config || !motor_config->step_counter_pio_config.pio) {
+        return 0;
+    }
+
+    taskENTER_CRITICAL();
+    int32_t steps = (int32_t) (step_counter_read(motor_config) - motor_config->position_step_count);
+    int64_t position_delta = (int64_t) steps * (MOTOR_POSITION_MICROSTEPS / motor_config->active_microsteps);
+    int64_t position_steps = motor_config->position_steps + (motor_is_forward(motor_config) ? position_delta : -position_delta);
+    taskEXIT_CRITICAL();
+
+    return position_steps;
+}
+
+
+float motor_get_revs_since(motor_select_t selected_motor, int64_t start_position) {
+    motor_config_t * motor_config = motor_get_config(selected_motor);
+
+    if (!motor_config) {
+        return 0.0f;
+    }
+
+    // Only the difference goes to float, it stays exact however long the motor has been running
+    int64_t position_delta = motor_get_position(selected_motor) - start_position;
+    uint32_t full_rotation_steps = motor_config->persistent_config.full_steps_per_rotation * MOTOR_POSITION_MICROSTEPS;
+
+    // The motor turns gear_ratio times slower than the trickler
+    return (float) position_delta / full_rotation_steps * motor_config->persistent_config.gear_ratio;
+}
+
+
+bool motor_get_telemetry(motor_select_t selected_motor, motor_telemetry_t * telemetry) {
+    motor_config_t * motor_config = NULL;
+    switch (selected_motor)
+    {
+    case SELECT_COARSE_TRICKLER_MOTOR:
+        motor_config = &coarse_trickler_motor_config;
+        break;
+    case SELECT_FINE_TRICKLER_MOTOR:
+        motor_config = &fine_trickler_motor_config;
+        break;
+    
+    default:
+        assert(false);
+        break;
+    }
+
+    if (!motor_config) {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    *telemetry = motor_config->telemetry;
+    taskEXIT_CRITICAL();
+
+    return telemetry->update_tick != 0;
+}
+
+
+// Bring the driver registers in line with the config, which may be changed from the REST API at any time. The
+// REST handler only updates the config so it never waits on the motor UART. Must hold the driver mutex.
+static void motor_driver_apply_config(motor_config_t * motor_config, TMC2209_t * tmc_driver) {
+    uint16_t current_ma = motor_config->persistent_config.current_ma;
+    if (tmc_driver->config.current != current_ma) {
+        tmc_driver->config.current = current_ma;
+        TMC2209_SetCurrent(tmc_driver, current_ma, tmc_driver->config.hold_current_pct);
+    }
+
+    // CoolStep and StallGuard run while TSTEP, the time between 1/256 microsteps, is at most TCOOLTHRS. Below
+    // MOTOR_STALLGUARD_MIN_SPEED_RPS the load reading is too weak to act on.
+    bool is_stallguard_used = motor_config->persistent_config.coolstep_enabled || motor_config->persistent_config.stall_threshold > 0;
+    uint32_t tcoolthrs = 0;
+    if (is_stallguard_used) {
+        float min_tstep_rate = MOTOR_STALLGUARD_MIN_SPEED_RPS * motor_config->persistent_config.full_steps_per_rotation * 256;
+        tcoolthrs = (uint32_t) fminf(TMC_FCLK_HZ / min_tstep_rate, TCOOLTHRS_MAX);
+    }
+    uint8_t semin = motor_config->persistent_config.coolstep_enabled ? COOLSTEP_SEMIN : 0;  // 0 turns CoolStep off
+
+    if (tmc_driver->tcoolthrs.reg.tcoolthrs != tcoolthrs) {
+        tmc_driver->tcoolthrs.reg.tcoolthrs = tcoolthrs;
+        TMC2209_WriteRegister(tmc_driver, (TMC2209_datagram_t *)&tmc_driver->tcoolthrs);
+    }
+
+    if (tmc_driver->coolconf.reg.semin != semin) {
+        tmc_driver->coolconf.reg.semin = semin;
+        tmc_driver->coolconf.reg.semax = COOLSTEP_SEMAX;
+        tmc_driver->coolconf.reg.seup = COOLSTEP_SEUP;
+        tmc_driver->coolconf.reg.sedn = COOLSTEP_SEDN;
+        tmc_driver->coolconf.reg.seimin = COOLSTEP_SEIMIN;
+        TMC2209_WriteRegister(tmc_driver, (TMC2209_datagram_t *)&tmc_driver->coolconf);
+    }
+}
+
+
+static void motor_telemetry_update(motor_config_t * motor_config, motor_select_t selected_motor) {
+    TMC2209_t * tmc_driver = (TMC2209_t *) motor_config->tmc_driver;
+    if (!tmc_driver) {
+        return;
+    }
+
+    xSemaphoreTake(motor_config->tmc_driver_mutex, portMAX_DELAY);
+
+    motor_driver_apply_config(motor_config, tmc_driver);
+
+    bool is_ok = TMC2209_ReadRegister(tmc_driver, (TMC2209_datagram_t *)&tmc_driver->sg_result) &&
+                 TMC2209_ReadRegister(tmc_driver, (TMC2209_datagram_t *)&tmc_driver->drv_status) &&
+                 TMC2209_ReadRegister(tmc_driver, (TMC2209_datagram_t *)&tmc_driver->tstep);
+
+    motor_telemetry_t telemetry = {
+        .sg_result = tmc_driver->sg_result.reg.result,
+        .cs_actual = tmc_driver->drv_status.reg.cs_actual,
+        .tstep = tmc_driver->tstep.reg.tstep,
+        .drv_status = tmc_driver->drv_status.reg.value,
+        .update_tick = xTaskGetTickCount(),
+    };
+
+    xSemaphoreGive(motor_config->tmc_driver_mutex);
+
+    if (!is_ok) {
+        return;
+    }
+
+    // A jam loads the motor until StallGuard reads close to 0. Only trust it while the motor turns fast enough
+    // for StallGuard to be on.
+    uint16_t stall_threshold = motor_config->persistent_config.stall_threshold;
+    bool is_stallguard_active = fabsf(motor_config->prev_velocity) >= MOTOR_STALLGUARD_MIN_SPEED_RPS;
+    if (stall_threshold > 0 && is_stallguard_active && telemetry.sg_result <= stall_threshold) {
+        if (motor_config->low_sg_result_count < MOTOR_JAM_DETECT_COUNT) {
+            motor_config->low_sg_result_count += 1;
+        }
+    }
+    else {
+        motor_config->low_sg_result_count = 0;
+    }
+    telemetry.is_jammed = motor_config->low_sg_result_count >= MOTOR_JAM_DETECT_COUNT;
+
+    if (telemetry.is_jammed && !motor_config->telemetry.is_jammed) {
+        printf("%s trickler jammed (SG_RESULT %u)\n", get_motor_select_string(selected_motor), telemetry.sg_result);
+    }
+
+    taskENTER_CRITICAL();
+    motor_config->telemetry = telemetry;
+    taskEXIT_CRITICAL();
+}
+
+
+// Polls both drivers in turn over the shared UART
+void motor_telemetry_task(void * p) {
+    TickType_t last_wake_tick = xTaskGetTickCount();
+
+    while (true) {
+        motor_telemetry_update(&coarse_trickler_motor_config, SELECT_COARSE_TRICKLER_MOTOR);
+        motor_telemetry_update(&fine_trickler_motor_config, SELECT_FINE_TRICKLER_MOTOR);
+
+        vTaskDelayUntil(&last_wake_tick, pdMS_TO_TICKS(MOTOR_TELEMETRY_PERIOD_MS));
+    }
+}
+
+
 motor_init_err_t motors_init(void) {
     bool is_ok;
 
@@ -577,7 +1121,8 @@ motor_init_err_t motors_init(void) {
     gpio_set_function(MOTOR_UART_RX, GPIO_FUNC_UART);
     gpio_set_function(MOTOR_UART_TX, GPIO_FUNC_UART);
 
-    _enable_uart_rx(MOTOR_UART, false);
+    // Replies are collected by the RX interrupt, the drivers are configured through the transport below
+    motor_uart_init();
 
     // 
     // Enable coarse trickler motor at UART ADDR 0
@@ -585,7 +1130,10 @@ motor_init_err_t motors_init(void) {
     driver_io_init(&coarse_trickler_motor_config);
 
     // Allocate PIO to the stepper
-    driver_pio_init(&coarse_trickler_motor_config);
+    is_ok = driver_pio_init(&coarse_trickler_motor_config);
+    if (!is_ok) {
+        return MOTOR_INIT_COARSE_DRV_ERR;
+    }
 
     // Initialize the stepper driver 
     is_ok = driver_init(&coarse_trickler_motor_config);
@@ -599,7 +1147,10 @@ motor_init_err_t motors_init(void) {
     driver_io_init(&fine_trickler_motor_config);
 
     // Allocate PIO to the stepper
-    driver_pio_init(&fine_trickler_motor_config);
+    is_ok = driver_pio_init(&fine_trickler_motor_config);
+    if (!is_ok) {
+        return MOTOR_INIT_FINE_DRV_ERR;
+    }
     
     // Initialize the stepper driver
     is_ok = driver_init(&fine_trickler_motor_config);
@@ -607,9 +1158,20 @@ motor_init_err_t motors_init(void) {
         return MOTOR_INIT_FINE_DRV_ERR;
     }
 
-    // Initialize motor related RTOS control
-    coarse_trickler_motor_config.stepper_speed_control_queue = xQueueCreate(2, sizeof(stepper_speed_control_t));
-    fine_trickler_motor_config.stepper_speed_control_queue = xQueueCreate(2, sizeof(stepper_speed_control_t));
+    // Initialize motor related RTOS control. Each queue is a mailbox holding only the latest setpoint, the
+    // task retargets to it even in the middle of a ramp.
+    coarse_trickler_motor_config.stepper_speed_control_queue = xQueueCreate(1, sizeof(float));
+    fine_trickler_motor_config.stepper_speed_control_queue = xQueueCreate(1, sizeof(float));
+    coarse_trickler_motor_config.ramp_dma_semaphore = xSemaphoreCreateBinary();
+    fine_trickler_motor_config.ramp_dma_semaphore = xSemaphoreCreateBinary();
+
+    // The stepper and telemetry tasks both talk to the drivers, and share the cached registers
+    coarse_trickler_motor_config.tmc_driver_mutex = xSemaphoreCreateMutex();
+    fine_trickler_motor_config.tmc_driver_mutex = xSemaphoreCreateMutex();
+
+    // Both motors share the DMA interrupt, it wakes whichever ramp needs its next table
+    irq_set_exclusive_handler(DMA_IRQ_0, _ramp_dma_irq_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
 
     // Create one task for each stepper controller
     xTaskCreate(stepper_speed_control_task, 
@@ -626,6 +1188,14 @@ motor_init_err_t motors_init(void) {
                 8, 
                 &fine_trickler_motor_config.stepper_speed_control_task_handler);
 
+    // Driver status is polled in the background at the lowest priority
+    xTaskCreate(motor_telemetry_task, 
+                "Motor Telemetry", 
+                configMINIMAL_STACK_SIZE, 
+                NULL, 
+                1, 
+                NULL);
+
     return MOTOR_INIT_OK;
 }
 
@@ -719,13 +1289,16 @@ int populate_rest_motor_config(motor_config_t * motor_config, char * buf, size_t
     // m7 (float): gear_ratio
     // m8 (bool): inverted_enable
     // m9 (bool): inverted_direction
+    // m10 (bool): coolstep_enabled
+    // m11 (int): stall_threshold
     // ee (bool): save to eeprom
 
     // Build response - return length for overflow checking
     return snprintf(buf,
                     max_len,
                     "%s"
-                    "{\"m0\":%0.3f,\"m1\":%ld,\"m2\":%d,\"m3\":%d,\"m4\":%d,\"m5\":%d,\"m6\":%0.3f,\"m7\":%0.7f,\"m8\":%s,\"m9\":%s}",
+                    "{\"m0\":%0.3f,\"m1\":%ld,\"m2\":%d,\"m3\":%d,\"m4\":%d,\"m5\":%d,\"m6\":%0.3f,\"m7\":%0.7f,\"m8\":%s,\"m9\":%s,"
+                    "\"m10\":%s,\"m11\":%d}",
                     http_json_header,
                     motor_config->persistent_config.angular_acceleration,
                     motor_config->persistent_config.full_steps_per_rotation,
@@ -736,7 +1309,9 @@ int populate_rest_motor_config(motor_config_t * motor_config, char * buf, size_t
                     motor_config->persistent_config.min_speed_rps,
                     motor_config->persistent_config.gear_ratio,
                     boolean_to_string(motor_config->persistent_config.inverted_enable),
-                    boolean_to_string(motor_config->persistent_config.inverted_direction));
+                    boolean_to_string(motor_config->persistent_config.inverted_direction),
+                    boolean_to_string(motor_config->persistent_config.coolstep_enabled),
+                    motor_config->persistent_config.stall_threshold);
 }
 
 bool apply_rest_motor_config(motor_config_t * motor_config, int num_params, char *params[], char *values[], struct fs_file *file) {
@@ -816,6 +1391,17 @@ bool apply_rest_motor_config(motor_config_t * motor_config, int num_params, char
             bool inverted_direction = string_to_boolean(values[idx]);
             motor_config->persistent_config.inverted_direction = inverted_direction;
         }
+        else if (strcmp(params[idx], "m10") == 0) {
+            motor_config->persistent_config.coolstep_enabled = string_to_boolean(values[idx]);
+        }
+        else if (strcmp(params[idx], "m11") == 0) {
+            int stall_threshold = atoi(values[idx]);
+            validation = validate_stall_threshold(stall_threshold);
+            if (!validation.is_valid) {
+                return send_validation_error(file, validation.error_message);
+            }
+            motor_config->persistent_config.stall_threshold = (uint16_t) stall_threshold;
+        }
         else if (strcmp(params[idx], "ee") == 0) {
             save_to_eeprom = string_to_boolean(values[idx]);
         }
@@ -831,7 +1417,7 @@ bool apply_rest_motor_config(motor_config_t * motor_config, int num_params, char
 
 
 bool http_rest_coarse_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    static char json_buffer[256];
+    static char json_buffer[320];
 
     // Apply configuration with validation
     if (!apply_rest_motor_config(&coarse_trickler_motor_config, num_params, params, values, file)) {
@@ -851,7 +1437,7 @@ bool http_rest_coarse_motor_config(struct fs_file *file, int num_params, char *p
 }
 
 bool http_rest_fine_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]) {
-    static char json_buffer[256];
+    static char json_buffer[320];
 
     // Apply configuration with validation
     if (!apply_rest_motor_config(&fine_trickler_motor_config, num_params, params, values, file)) {
@@ -869,3 +1455,55 @@ bool http_rest_fine_motor_config(struct fs_file *file, int num_params, char *par
 
     return true;
 }
+
+
+bool http_rest_motor_telemetry(struct fs_file *file, int num_params, char *params[], char *values[]) {
+    // Mappings
+    // t0 (motor_select_t | int): 0 for the coarse trickler, 1 for the fine trickler
+    // t1 (uint16_t): SG_RESULT
+    // t2 (uint8_t): CS_ACTUAL
+    // t3 (uint32_t): TSTEP
+    // t4 (uint32_t): DRV_STATUS
+    // t5 (bool): Jammed
+    // t6 (uint32_t): Age of the reading in ms
+
+    static char motor_telemetry_json_buffer[160];
+
+    motor_select_t selected_motor = SELECT_COARSE_TRICKLER_MOTOR;
+
+    for (int idx = 0; idx < num_params; idx += 1) {
+        if (strcmp(params[idx], "t0") == 0) {
+            int motor = atoi(values[idx]);
+            if (!is_in_range_int(motor, SELECT_COARSE_TRICKLER_MOTOR, SELECT_FINE_TRICKLER_MOTOR)) {
+                return send_validation_error(file, "Invalid motor (0-1)");
+            }
+            selected_motor = (motor_select_t) motor;
+        }
+    }
+
+    motor_telemetry_t telemetry;
+    if (!motor_get_telemetry(selected_motor, &telemetry)) {
+        return send_validation_error(file, "No telemetry from the motor driver");
+    }
+
+    int len = snprintf(motor_telemetry_json_buffer, 
+                       sizeof(motor_telemetry_json_buffer),
+                       "%s"
+                       "{\"t0\":%d,\"t1\":%u,\"t2\":%u,\"t3\":%lu,\"t4\":%lu,\"t5\":%s,\"t6\":%lu}",
+                       http_json_header,
+                       selected_motor,
+                       telemetry.sg_result,
+                       telemetry.cs_actual,
+                       telemetry.tstep,
+                       telemetry.drv_status,
+                       boolean_to_string(telemetry.is_jammed),
+                       (xTaskGetTickCount() - telemetry.update_tick) * portTICK_PERIOD_MS);
+    CHECK_SNPRINTF_OVERFLOW(len, sizeof(motor_telemetry_json_buffer), file);
+
+    file->data = motor_telemetry_json_buffer;
+    file->len = len;
+    file->index = len;
+    file->flags = FS_FILE_FLAGS_HEADER_INCLUDED;
+
+    return true;
+}
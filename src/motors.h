@@ -4,11 +4,23 @@
 #include <stdint.h>
 #include <FreeRTOS.h>
 #include <queue.h>
+#include <semphr.h>
 
 #include "common.h"
 #include "http_rest.h"
 
-#define EEPROM_MOTOR_DATA_REV                     5              // 16 byte 
+#define EEPROM_MOTOR_DATA_REV                     6              // 16 byte 
+
+#define MOTOR_RAMP_TABLE_LEN                      128            // Step periods streamed per DMA transfer
+
+#define MOTOR_HIGH_SPEED_MICROSTEPS               16             // Resolution used above the switch step rate
+#define MOTOR_MICROSTEP_SWITCH_UP_RATE_HZ         250000         // Step rate at the configured resolution to switch up
+#define MOTOR_MICROSTEP_SWITCH_DOWN_RATE_HZ       200000         // and to switch back, lower for hysteresis
+#define MOTOR_POSITION_MICROSTEPS                 256            // Unit of the position, whatever the resolution
+
+#define MOTOR_TELEMETRY_PERIOD_MS                 100            // Driver status poll period per motor
+#define MOTOR_JAM_DETECT_COUNT                    3              // Consecutive low StallGuard readings to report a jam
+#define MOTOR_STALLGUARD_MIN_SPEED_RPS            1.0f           // Motor speed below which CoolStep and StallGuard are off
 
 
 // Terms
@@ -43,6 +55,9 @@ typedef struct {
 
     bool inverted_direction;
     bool inverted_enable;
+
+    bool coolstep_enabled;       // Scale the current with the load
+    uint16_t stall_threshold;    // SG_RESULT at or below which a running motor is jammed, 0 to disable
 } motor_persistent_config_t;
 
 
@@ -52,6 +67,16 @@ typedef struct {
 } eeprom_motor_data_t;
 
 
+typedef struct {
+    uint16_t sg_result;          // StallGuard load measurement, drops towards 0 as the load increases
+    uint8_t cs_actual;           // Current scale (0-31) chosen by CoolStep
+    uint32_t tstep;              // Time between steps in 1/fCLK, 0xFFFFF at standstill
+    uint32_t drv_status;         // Raw DRV_STATUS, with the over temperature and short flags
+    uint32_t update_tick;        // Tick count of the last successful poll
+    bool is_jammed;
+} motor_telemetry_t;
+
+
 typedef struct {
     // Setings that should be read from EEPROM
     motor_persistent_config_t persistent_config;
@@ -65,14 +90,36 @@ typedef struct {
     // Set at run time
     void * tmc_driver;
     pio_config_t pio_config;
+    pio_config_t step_counter_pio_config;
+
+    // Speed ramp, one period per step is streamed into the PIO TX FIFO by two chained DMA channels paced by
+    // the TX DREQ. Each table is refilled while the other channel runs.
+    int ramp_dma_channel[2];
+    uint32_t ramp_table[2][MOTOR_RAMP_TABLE_LEN];
+    SemaphoreHandle_t ramp_dma_semaphore;  // Given when a table is done or a new setpoint arrives
 
     // Used to store some live data
     float prev_velocity;
     bool step_direction;
+    uint16_t active_microsteps;  // Resolution the driver runs at, switched with the speed
+
+    // Resolution and step period to take over the moment the MRES write is out, see motor_switch_microsteps()
+    uint16_t pending_microsteps;
+    uint32_t pending_period;
+
+    // Signed position in 1/MOTOR_POSITION_MICROSTEPS steps up to the last direction or resolution change, and
+    // the step counter reading at that point
+    int64_t position_steps;
+    uint32_t position_step_count;
+
+    // Driver status, updated by the telemetry task
+    motor_telemetry_t telemetry;
+    uint8_t low_sg_result_count;
 
     // RTOS control
     TaskHandle_t stepper_speed_control_task_handler;
     QueueHandle_t stepper_speed_control_queue;
+    SemaphoreHandle_t tmc_driver_mutex;  // Held for any access to the driver registers after init
 } motor_config_t;
 
 
@@ -89,6 +136,17 @@ void motor_task(void *p);
 void motor_set_speed(motor_select_t selected_motor, float new_velocity);
 uint16_t get_motor_max_speed(motor_select_t selected_motor);
 float get_motor_min_speed(motor_select_t selected_motor);
+float get_motor_acceleration(motor_select_t selected_motor);
+
+// Motor position since power up in 1/MOTOR_POSITION_MICROSTEPS steps, from the steps actually issued. Negative
+// when running in reverse.
+int64_t motor_get_position(motor_select_t selected_motor);
+
+// Revolutions of the trickler since the given motor_get_position()
+float motor_get_revs_since(motor_select_t selected_motor, int64_t start_position);
+
+// Latest driver status from the telemetry task
+bool motor_get_telemetry(motor_select_t selected_motor, motor_telemetry_t * telemetry);
 void motor_enable(motor_select_t selected_motor, bool enable);
 const char * get_motor_select_string(motor_select_t selected_motor);
 void handle_motor_init_error(motor_init_err_t err) __attribute__((noreturn));
@@ -96,6 +154,7 @@ void handle_motor_init_error(motor_init_err_t err) __attribute__((noreturn));
 // REST interface
 bool http_rest_coarse_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]);
 bool http_rest_fine_motor_config(struct fs_file *file, int num_params, char *params[], char *values[]);
+bool http_rest_motor_telemetry(struct fs_file *file, int num_params, char *params[], char *values[]);
 
 
 #ifdef __cplusplus
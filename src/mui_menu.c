@@ -564,7 +564,7 @@ fds_t fds_data[] = {
     MUI_XYAT("SD", 50, 25, 60, "A&D FX-i Std|Steinberg SBS|G&G JJB|US Solid JFDBS|JM Science|Creedmoor|Radwag PS R2")
 
     MUI_LABEL(5,37, "Baudrate:")
-    MUI_XYAT("BR", 50, 37, 60, "4800|9600|19200")
+    MUI_XYAT("BR", 50, 37, 60, "4800|9600|19200|38400")
 
     MUI_STYLE(0)
     MUI_XYAT("BN", 64, 59, 31, " OK ")
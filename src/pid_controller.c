@@ -0,0 +1,90 @@
+#include <math.h>
+#include <string.h>
+
+#include "pid_controller.h"
+
+
+void pid_controller_init(pid_controller_t * pid, const pid_controller_config_t * config) {
+    memset(pid, 0x0, sizeof(pid_controller_t));
+    pid->config = *config;
+
+    pid_controller_reset(pid);
+}
+
+
+void pid_controller_reset(pid_controller_t * pid) {
+    pid->has_last_measurement = false;
+    pid->last_measurement = 0.0f;
+    pid->last_update_us = 0;
+    pid->integral = 0.0f;
+    pid->derivative = 0.0f;
+    pid->output = 0.0f;
+}
+
+
+float pid_controller_update(pid_controller_t * pid, float set_point, float measurement, uint32_t tick_us) {
+    return pid_controller_update_with_feed_forward(pid, set_point, measurement, tick_us, 0.0f);
+}
+
+
+float pid_controller_update_with_feed_forward(pid_controller_t * pid, float set_point, float measurement, uint32_t tick_us,
+                                              float feed_forward) {
+    const pid_controller_config_t * config = &pid->config;
+
+    // A bad frame would stay in the integral and the derivative for the rest of the run, hold the last output
+    if (!isfinite(measurement) || !isfinite(set_point) || !isfinite(feed_forward)) {
+        return pid->output;
+    }
+
+    float error = set_point - measurement;
+
+    // Two frames can carry the same timestamp, they then only update the proportional term
+    float dt_s = 0.0f;
+    if (pid->has_last_measurement) {
+        int32_t dt_us = (int32_t) (tick_us - pid->last_update_us);
+        dt_s = dt_us > 0 ? dt_us * 1e-6f : 0.0f;
+    }
+
+    if (dt_s > 0.0f) {
+        // Derivative on measurement, the error changes at the negative rate of the measurement
+        float raw_derivative = -(measurement - pid->last_measurement) / dt_s;
+
+        if (config->derivative_filter_tau_s > 0.0f) {
+            float alpha = dt_s / (config->derivative_filter_tau_s + dt_s);
+            pid->derivative += alpha * (raw_derivative - pid->derivative);
+        }
+        else {
+            pid->derivative = raw_derivative;
+        }
+    }
+
+    float unsaturated_output = feed_forward + config->kp * error + config->ki * pid->integral + config->kd * pid->derivative;
+
+    // Conditional integration, only while the output isn't pinned against the limit the error pushes towards
+    if (dt_s > 0.0f) {
+        bool is_saturated_high = unsaturated_output >= config->output_max && error > 0.0f;
+        bool is_saturated_low = unsaturated_output <= config->output_min && error < 0.0f;
+
+        if (!is_saturated_high && !is_saturated_low) {
+            pid->integral += error * dt_s;
+            unsaturated_output = feed_forward + config->kp * error + config->ki * pid->integral + config->kd * pid->derivative;
+        }
+    }
+
+    float output = fmaxf(config->output_min, fminf(unsaturated_output, config->output_max));
+
+    // Slew limit, the first output of a run is taken as is
+    if (config->slew_rate_limit > 0.0f && pid->has_last_measurement) {
+        float max_step = config->slew_rate_limit * dt_s;
+        output = fmaxf(pid->output - max_step, fminf(output, pid->output + max_step));
+    }
+
+    if (dt_s > 0.0f || !pid->has_last_measurement) {
+        pid->last_update_us = tick_us;
+        pid->last_measurement = measurement;
+        pid->has_last_measurement = true;
+    }
+    pid->output = output;
+
+    return output;
+}
@@ -0,0 +1,69 @@
+#ifndef PID_CONTROLLER_H_
+#define PID_CONTROLLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Discrete PID controller
+ *
+ * - The time step comes from the measurement timestamps in microseconds, so a
+ *   late or early frame doesn't scale the integral or the derivative
+ * - The derivative is taken on the measurement rather than the error and is
+ *   low-pass filtered, so neither a set point change nor the scale resolution
+ *   produces a spike
+ * - Conditional integration: the integral is frozen while the output is
+ *   saturated in the direction the error pushes it (anti-windup)
+ * - The output is clamped to [output_min, output_max] and its rate of change
+ *   can be limited
+ * - An optional feed-forward is added ahead of the clamp, the PID terms then
+ *   only correct what the feed-forward gets wrong
+ *
+ * Usage:
+ * 1. pid_controller_init(&pid, &config)
+ * 2. Call pid_controller_update() with every measurement
+ * 3. pid_controller_reset() before reusing it for a new run
+ */
+
+typedef struct {
+    float kp;
+    float ki;                       // Per second of integrated error
+    float kd;                       // Per unit of error change per second
+
+    float output_min;
+    float output_max;
+
+    float derivative_filter_tau_s;  // Time constant of the derivative low-pass, 0 to disable
+    float slew_rate_limit;          // Max output change per second, 0 to disable
+} pid_controller_config_t;
+
+typedef struct {
+    pid_controller_config_t config;
+
+    bool has_last_measurement;
+    float last_measurement;
+    uint32_t last_update_us;
+
+    float integral;
+    float derivative;               // Filtered rate of change of the error
+    float output;
+} pid_controller_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pid_controller_init(pid_controller_t * pid, const pid_controller_config_t * config);
+void pid_controller_reset(pid_controller_t * pid);
+
+// Returns the new output. A non-finite measurement or set point is ignored and returns the last output.
+float pid_controller_update(pid_controller_t * pid, float set_point, float measurement, uint32_t tick_us);
+float pid_controller_update_with_feed_forward(pid_controller_t * pid, float set_point, float measurement, uint32_t tick_us,
+                                              float feed_forward);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PID_CONTROLLER_H_
@@ -30,6 +30,17 @@ const profile_t default_ar_2208_profile = {
     .fine_max_flow_speed_rps = 3.0f,
 
     .ai_tuning_enabled = false,
+
+    .inflight_compensation_enabled = false,
+    .inflight_mass = 0.0f,
+    .inflight_delay_ms = 0.0f,
+
+    .flow_model_enabled = false,
+    .coarse_weight_per_rev = 0.0f,
+    .fine_weight_per_rev = 0.0f,
+
+    .coarse_backoff_angle_deg = 0.0f,
+    .coarse_backoff_speed_rps = 1.0f,
 };
 
 
@@ -53,6 +64,17 @@ const profile_t default_ar_2209_profile = {
     .fine_max_flow_speed_rps = 5.0f,
 
     .ai_tuning_enabled = false,
+
+    .inflight_compensation_enabled = false,
+    .inflight_mass = 0.0f,
+    .inflight_delay_ms = 0.0f,
+
+    .flow_model_enabled = false,
+    .coarse_weight_per_rev = 0.0f,
+    .fine_weight_per_rev = 0.0f,
+
+    .coarse_backoff_angle_deg = 0.0f,
+    .coarse_backoff_speed_rps = 1.0f,
 };
 
 
@@ -151,8 +173,16 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
     // p11 (float): fine_min_flow_speed_rps
     // p12 (float): fine_max_flow_speed_rps
     // p13 (bool): ai_tuning_enabled
+    // p14 (bool): inflight_compensation_enabled
+    // p15 (float): inflight_mass
+    // p16 (float): inflight_delay_ms
+    // p17 (bool): flow_model_enabled
+    // p18 (float): coarse_weight_per_rev
+    // p19 (float): fine_weight_per_rev
+    // p20 (float): coarse_backoff_angle_deg
+    // p21 (float): coarse_backoff_speed_rps
     // ee (bool): save to eeprom
-    static char buf[256];
+    static char buf[448];
 
     // Read the current loaded profile index
     uint8_t profile_idx = profile_get_selected_idx();
@@ -267,6 +297,60 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
             else if (strcmp(params[idx], "p13") == 0) {
                 current_profile->ai_tuning_enabled = string_to_boolean(values[idx]);
             }
+            else if (strcmp(params[idx], "p14") == 0) {
+                current_profile->inflight_compensation_enabled = string_to_boolean(values[idx]);
+            }
+            else if (strcmp(params[idx], "p15") == 0) {
+                float value = strtof(values[idx], NULL);
+                validation = validate_inflight_mass(value);
+                if (!validation.is_valid) {
+                    return send_validation_error(file, validation.error_message);
+                }
+                current_profile->inflight_mass = value;
+            }
+            else if (strcmp(params[idx], "p16") == 0) {
+                float value = strtof(values[idx], NULL);
+                validation = validate_inflight_delay_ms(value);
+                if (!validation.is_valid) {
+                    return send_validation_error(file, validation.error_message);
+                }
+                current_profile->inflight_delay_ms = value;
+            }
+            else if (strcmp(params[idx], "p17") == 0) {
+                current_profile->flow_model_enabled = string_to_boolean(values[idx]);
+            }
+            else if (strcmp(params[idx], "p18") == 0) {
+                float value = strtof(values[idx], NULL);
+                validation = validate_weight_per_rev(value);
+                if (!validation.is_valid) {
+                    return send_validation_error(file, validation.error_message);
+                }
+                current_profile->coarse_weight_per_rev = value;
+            }
+            else if (strcmp(params[idx], "p19") == 0) {
+                float value = strtof(values[idx], NULL);
+                validation = validate_weight_per_rev(value);
+                if (!validation.is_valid) {
+                    return send_validation_error(file, validation.error_message);
+                }
+                current_profile->fine_weight_per_rev = value;
+            }
+            else if (strcmp(params[idx], "p20") == 0) {
+                float value = strtof(values[idx], NULL);
+                validation = validate_backoff_angle(value);
+                if (!validation.is_valid) {
+                    return send_validation_error(file, validation.error_message);
+                }
+                current_profile->coarse_backoff_angle_deg = value;
+            }
+            else if (strcmp(params[idx], "p21") == 0) {
+                float value = strtof(values[idx], NULL);
+                validation = validate_backoff_speed(value);
+                if (!validation.is_valid) {
+                    return send_validation_error(file, validation.error_message);
+                }
+                current_profile->coarse_backoff_speed_rps = value;
+            }
             else if (strcmp(params[idx], "ee") == 0) {
                 save_to_eeprom = string_to_boolean(values[idx]);
             }
@@ -280,7 +364,7 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
         // Response
         int len = snprintf(buf, sizeof(buf),
                           "%s"
-                          "{\"pf\":%d,\"p0\":%ld,\"p1\":%ld,\"p2\":\"%s\",\"p3\":%0.3f,\"p4\":%0.3f,\"p5\":%0.3f,\"p6\":%0.3f,\"p7\":%0.3f,\"p8\":%0.3f,\"p9\":%0.3f,\"p10\":%0.3f,\"p11\":%0.3f,\"p12\":%0.3f,\"p13\":%s}",
+                          "{\"pf\":%d,\"p0\":%ld,\"p1\":%ld,\"p2\":\"%s\",\"p3\":%0.3f,\"p4\":%0.3f,\"p5\":%0.3f,\"p6\":%0.3f,\"p7\":%0.3f,\"p8\":%0.3f,\"p9\":%0.3f,\"p10\":%0.3f,\"p11\":%0.3f,\"p12\":%0.3f,\"p13\":%s,\"p14\":%s,\"p15\":%0.3f,\"p16\":%0.1f,\"p17\":%s,\"p18\":%0.4f,\"p19\":%0.4f,\"p20\":%0.1f,\"p21\":%0.3f}",
                           http_json_header,
                           profile_idx,
                           current_profile->rev,
@@ -296,7 +380,15 @@ bool http_rest_profile_config(struct fs_file *file, int num_params, char *params
                           current_profile->fine_kd,
                           current_profile->fine_min_flow_speed_rps,
                           current_profile->fine_max_flow_speed_rps,
-                          current_profile->ai_tuning_enabled ? "true" : "false");
+                          current_profile->ai_tuning_enabled ? "true" : "false",
+                          current_profile->inflight_compensation_enabled ? "true" : "false",
+                          current_profile->inflight_mass,
+                          current_profile->inflight_delay_ms,
+                          current_profile->flow_model_enabled ? "true" : "false",
+                          current_profile->coarse_weight_per_rev,
+                          current_profile->fine_weight_per_rev,
+                          current_profile->coarse_backoff_angle_deg,
+                          current_profile->coarse_backoff_speed_rps);
 
         CHECK_SNPRINTF_OVERFLOW(len, sizeof(buf), file);
 
@@ -9,7 +9,7 @@
 #define PROFILE_NAME_MAX_LEN    16
 #define MAX_PROFILE_CNT         8
 
-#define EEPROM_PROFILE_DATA_REV             2           // 16 bit (incremented for AI tuning field)
+#define EEPROM_PROFILE_DATA_REV             5           // 16 bit (incremented for coarse back-off fields)
 
 typedef struct
 {
@@ -34,6 +34,20 @@ typedef struct
 
     // AI Auto-Tuning
     bool ai_tuning_enabled;       // Enable AI auto-tuning for this profile
+
+    // In-flight compensation, stop the tricklers early by the predicted carry-over
+    bool inflight_compensation_enabled;
+    float inflight_mass;          // Learned, lands after the stop regardless of the flow rate
+    float inflight_delay_ms;      // Learned, powder in the air plus the scale lag in ms of flow
+
+    // Flow model, run the coarse trickler flat out for the predicted weight before handing off to the PID
+    bool flow_model_enabled;
+    float coarse_weight_per_rev;  // Learned, e.g. grains per revolution
+    float fine_weight_per_rev;    // Learned
+
+    // Reverse the coarse trickler when it cuts out to pull back the powder hanging over the end of the tube
+    float coarse_backoff_angle_deg;   // 0 to disable
+    float coarse_backoff_speed_rps;
 } profile_t;
 
 
@@ -57,6 +71,7 @@ bool profile_data_save();
 
 profile_t * profile_select(uint8_t idx);
 profile_t * profile_get_selected();
+uint16_t profile_get_selected_idx();
 
 // REST interface
 bool http_rest_profile_config(struct fs_file *file, int num_params, char *params[], char *values[]);
@@ -14,6 +14,8 @@
 #include "cleanup_mode.h"
 #include "servo_gate.h"
 #include "system_control.h"
+#include "drop_trace.h"
+#include "drop_history.h"
 
 // Generated headers by html2header.py under scripts
 #include "display_mirror.html.h"
@@ -85,10 +87,14 @@ bool rest_endpoints_init(bool default_wizard) {
     rest_register_handler("/rest/scale_config", http_rest_scale_config);
     rest_register_handler("/rest/charge_mode_config", http_rest_charge_mode_config);
     rest_register_handler("/rest/charge_mode_state", http_rest_charge_mode_state);
+    rest_register_handler("/rest/charge_mode_session", http_rest_charge_mode_session);
+    rest_register_handler("/rest/drop_trace", http_rest_drop_trace);
+    rest_register_handler("/rest/drop_history", http_rest_drop_history);
     rest_register_handler("/rest/cleanup_mode_state", http_rest_cleanup_mode_state);
     rest_register_handler("/rest/system_control", http_rest_system_control);
     rest_register_handler("/rest/coarse_motor_config", http_rest_coarse_motor_config);
     rest_register_handler("/rest/fine_motor_config", http_rest_fine_motor_config);
+    rest_register_handler("/rest/motor_telemetry", http_rest_motor_telemetry);
     rest_register_handler("/rest/button_control", http_rest_button_control);
     rest_register_handler("/rest/mini_12864_config", http_rest_mini_12864_module_config);
     rest_register_handler("/rest/wireless_config", http_rest_wireless_config);
@@ -2,11 +2,13 @@
 #include <FreeRTOS.h>
 #include <queue.h>
 #include <stdlib.h>
+#include <string.h>
 #include <semphr.h>
 #include <inttypes.h>
 
 #include "configuration.h"
 #include "scale.h"
+#include "scale_uart_rx.h"
 #include "eeprom.h"
 #include "app.h"
 #include "scale.h"
@@ -23,6 +25,9 @@ extern scale_handle_t radwag_ps_r2_scale_handle;
 
 scale_config_t scale_config;
 
+#define SCALE_MEASUREMENT_STREAM_MASK   (SCALE_MEASUREMENT_STREAM_LEN - 1)
+#define SCALE_MEASUREMENT_ODD_BIT       (1 << 0)
+#define SCALE_MEASUREMENT_EVEN_BIT      (1 << 1)
 
 
 void set_scale_driver(scale_driver_t scale_driver) {
@@ -84,6 +89,9 @@ uint32_t get_scale_baudrate(scale_baudrate_t scale_baudrate) {
         case BAUDRATE_19200:
             baudrate_uint = 19200;
             break;
+        case BAUDRATE_38400:
+            baudrate_uint = 38400;
+            break;
         default:
             break;
     }
@@ -92,6 +100,19 @@ uint32_t get_scale_baudrate(scale_baudrate_t scale_baudrate) {
 }
 
 
+void scale_uart_set_framing(scale_framing_t scale_framing) {
+    switch (scale_framing) {
+        case SCALE_FRAMING_7E1:
+            uart_set_format(SCALE_UART, 7, 1, UART_PARITY_EVEN);
+            break;
+        case SCALE_FRAMING_8N1:
+        default:
+            uart_set_format(SCALE_UART, 8, 1, UART_PARITY_NONE);
+            break;
+    }
+}
+
+
 const char * get_scale_driver_string() {
     const char * scale_driver_string = NULL;
 
@@ -141,6 +162,7 @@ bool scale_init() {
         scale_config.persistent_config.scale_data_rev = EEPROM_SCALE_DATA_REV;
         scale_config.persistent_config.scale_driver = SCALE_DRIVER_AND_FXI;
         scale_config.persistent_config.scale_baudrate = BAUDRATE_19200;
+        scale_config.persistent_config.scale_framing = SCALE_FRAMING_8N1;
 
         // Write data back
         is_ok = scale_config_save();
@@ -151,30 +173,32 @@ bool scale_init() {
     }
 
     // Initialize UART
-    uart_init(SCALE_UART, get_scale_baudrate(scale_config.persistent_config.scale_baudrate));
+    uint actual_baudrate = uart_init(SCALE_UART, get_scale_baudrate(scale_config.persistent_config.scale_baudrate));
+    scale_uart_set_framing(scale_config.persistent_config.scale_framing);
 
     gpio_set_function(SCALE_UART_TX, GPIO_FUNC_UART);
     gpio_set_function(SCALE_UART_RX, GPIO_FUNC_UART);
 
+    // Received bytes are buffered and timestamped by the RX interrupt
+    scale_uart_rx_init(actual_baudrate);
+
     // Create control variables
-    // Semaphore to indicate the availability of new measurement.
-    scale_config.scale_measurement_ready = xSemaphoreCreateBinary();
+    // Event group to indicate the availability of new measurement, unlike a semaphore it wakes all waiters.
+    scale_config.scale_measurement_event = xEventGroupCreate();
 
     // Mutex to control the access to the serial port write
     scale_config.scale_serial_write_access_mutex = xSemaphoreCreateMutex();
 
-    // Mutex to protect current_scale_measurement from concurrent access
-    scale_config.scale_measurement_mutex = xSemaphoreCreateMutex();
-
-    // Initialize the measurement variable
-    scale_config.current_scale_measurement = NAN;
+    // Initialize the measurement stream (no measurement yet)
+    memset(scale_config.measurement_stream, 0x0, sizeof(scale_config.measurement_stream));
+    scale_config.latest_measurement_seq = 0;
 
     // Initialize the driver handle
     printf("Scale driver: %x\n", scale_config.persistent_config.scale_driver);
     set_scale_driver(scale_config.persistent_config.scale_driver);
 
     // Create the Task for the listener loop
-    xTaskCreate(scale_config.scale_handle->read_loop_task, "Scale Task", configMINIMAL_STACK_SIZE, NULL, 9, NULL);
+    xTaskCreate(scale_config.scale_handle->read_loop_task, "Scale Task", configMINIMAL_STACK_SIZE, scale_config.scale_handle, 9, NULL);
 
     // Register to eeprom save all
     eeprom_register_handler(scale_config_save);
@@ -214,52 +238,159 @@ void scale_write(const char * command, size_t len) {
 }
 
 
-// Thread-safe setter for scale measurement (used by scale drivers)
-void scale_set_current_measurement(float value) {
-    BaseType_t scheduler_state = xTaskGetSchedulerState();
-    if (scheduler_state != taskSCHEDULER_NOT_STARTED) {
-        xSemaphoreTake(scale_config.scale_measurement_mutex, portMAX_DELAY);
+// The bit of the seq parity stays set until the next measurement, so a waiter that checks the stream and then
+// blocks can't miss a measurement published in between
+static EventBits_t _measurement_event_bit(uint32_t seq) {
+    return (seq & 1) ? SCALE_MEASUREMENT_ODD_BIT : SCALE_MEASUREMENT_EVEN_BIT;
+}
+
+
+/*
+    Publish a new measurement to the stream. Must only be called from the scale driver task (single producer).
+
+    The slot is invalidated (seq = 0) before it is rewritten and only gets its new seq once the content is
+    complete, so readers on either core can detect a torn read by comparing the slot seq before and after
+    the copy.
+*/
+void scale_publish_measurement(weight_fixed_t weight, scale_stability_t stability, uint32_t rx_time_us) {
+    uint32_t seq = scale_config.latest_measurement_seq + 1;
+    scale_measurement_t * slot = &scale_config.measurement_stream[seq & SCALE_MEASUREMENT_STREAM_MASK];
+
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->weight = weight;
+    slot->tick_us = rx_time_us;
+    slot->stability = stability;
+
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&scale_config.latest_measurement_seq, seq, __ATOMIC_RELEASE);
+
+    // Signal the data is ready to all waiters
+    if (scale_config.scale_measurement_event) {
+        xEventGroupSetBits(scale_config.scale_measurement_event, _measurement_event_bit(seq));
+        xEventGroupClearBits(scale_config.scale_measurement_event, _measurement_event_bit(seq + 1));
     }
-    scale_config.current_scale_measurement = value;
-    if (scheduler_state != taskSCHEDULER_NOT_STARTED) {
-        xSemaphoreGive(scale_config.scale_measurement_mutex);
+}
+
+
+static bool _read_measurement_slot(uint32_t seq, scale_measurement_t * measurement) {
+    scale_measurement_t * slot = &scale_config.measurement_stream[seq & SCALE_MEASUREMENT_STREAM_MASK];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq) {
+        return false;
     }
+
+    measurement->weight = slot->weight;
+    measurement->tick_us = slot->tick_us;
+    measurement->stability = slot->stability;
+    measurement->seq = seq;
+
+    // The slot was overwritten while copying
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq;
+}
+
+
+uint32_t scale_get_latest_seq(void) {
+    return __atomic_load_n(&scale_config.latest_measurement_seq, __ATOMIC_ACQUIRE);
 }
 
-float scale_get_current_measurement() {
-    float measurement;
-    BaseType_t scheduler_state = xTaskGetSchedulerState();
 
-    if (scheduler_state != taskSCHEDULER_NOT_STARTED) {
-        xSemaphoreTake(scale_config.scale_measurement_mutex, portMAX_DELAY);
+bool scale_get_latest_measurement(scale_measurement_t * measurement) {
+    while (true) {
+        uint32_t latest_seq = scale_get_latest_seq();
+        if (latest_seq == 0) {
+            return false;
+        }
+
+        // Only fails if the producer has lapped the whole ring in the meantime, then try the newer one
+        if (_read_measurement_slot(latest_seq, measurement)) {
+            return true;
+        }
     }
-    measurement = scale_config.current_scale_measurement;
-    if (scheduler_state != taskSCHEDULER_NOT_STARTED) {
-        xSemaphoreGive(scale_config.scale_measurement_mutex);
+}
+
+
+/*
+    Copy up to max_len measurements newer than seq, oldest first. Returns the number of measurements copied.
+
+    Each consumer keeps its own cursor (the seq of the last measurement it has processed). If the consumer
+    has fallen behind by more than the stream length, the oldest measurements are lost and the gap is
+    visible from the seq of the returned measurements.
+*/
+size_t scale_read_since(uint32_t seq, scale_measurement_t * measurements, size_t max_len) {
+    uint32_t latest_seq = scale_get_latest_seq();
+    size_t len = 0;
+
+    // The slot after the latest one may be under rewrite, so skip it
+    if (latest_seq - seq > SCALE_MEASUREMENT_STREAM_LEN - 1) {
+        seq = latest_seq - (SCALE_MEASUREMENT_STREAM_LEN - 1);
     }
 
-    return measurement;
+    for (uint32_t next_seq = seq + 1; len < max_len && next_seq - 1 != latest_seq; next_seq++) {
+        if (_read_measurement_slot(next_seq, &measurements[len])) {
+            len += 1;
+        }
+    }
+
+    return len;
 }
 
 
 /*
-    Block wait for the next available measurement.
+    Block wait for the first measurement newer than seq.
 
-    block_time_ms set to 0 to wait indefinitely.
+    Unlike scale_block_wait_for_next_measurement() it returns immediately if the consumer hasn't caught up
+    with the stream yet, so no frame is missed. block_time_ms set to 0 to wait indefinitely.
 */
-bool scale_block_wait_for_next_measurement(uint32_t block_time_ms, float * current_measurement) {
-    TickType_t delay_ticks;
+bool scale_wait_for_measurement_since(uint32_t seq, uint32_t block_time_ms, scale_measurement_t * measurement) {
+    TickType_t start_tick = xTaskGetTickCount();
+    TickType_t timeout_ticks = (block_time_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(block_time_ms);
+
+    while (true) {
+        uint32_t latest_seq = scale_get_latest_seq();
+        if (scale_read_since(seq, measurement, 1) == 1) {
+            return true;
+        }
+
+        TickType_t remaining_ticks = portMAX_DELAY;
+        if (timeout_ticks != portMAX_DELAY) {
+            TickType_t elapsed_ticks = xTaskGetTickCount() - start_tick;
+            if (elapsed_ticks >= timeout_ticks) {
+                return false;
+            }
+            remaining_ticks = timeout_ticks - elapsed_ticks;
+        }
 
-    if (block_time_ms == 0) {
-        delay_ticks = portMAX_DELAY;
+        xEventGroupWaitBits(scale_config.scale_measurement_event, _measurement_event_bit(latest_seq + 1), 
+                            pdFALSE, pdFALSE, remaining_ticks);
     }
-    else {
-        delay_ticks = pdMS_TO_TICKS(block_time_ms);
+}
+
+
+float scale_get_current_measurement() {
+    scale_measurement_t measurement;
+
+    if (!scale_get_latest_measurement(&measurement)) {
+        return NAN;
     }
 
+    return weight_to_float(measurement.weight);
+}
+
+
+/*
+    Block wait for the next available measurement.
+
+    block_time_ms set to 0 to wait indefinitely.
+*/
+bool scale_block_wait_for_next_measurement(uint32_t block_time_ms, float * current_measurement) {
+    scale_measurement_t measurement;
+
     // You can only call this once the scheduler starts
-    if (xSemaphoreTake(scale_config.scale_measurement_ready, delay_ticks) == pdTRUE){
-        *current_measurement = scale_get_current_measurement();
+    if (scale_wait_for_measurement_since(scale_get_latest_seq(), block_time_ms, &measurement)) {
+        *current_measurement = weight_to_float(measurement.weight);
 
         return true;
     }
@@ -6,9 +6,16 @@
 
 #include "app.h"
 #include "http_rest.h"
+#include "weight.h"
 #include <semphr.h>
+#include <event_groups.h>
 
-#define EEPROM_SCALE_DATA_REV                     3              // 16 byte 
+#define EEPROM_SCALE_DATA_REV                     4              // 16 byte 
+
+#define SCALE_MEASUREMENT_STREAM_LEN              32             // Must be power of two
+
+
+typedef struct scale_frame_descriptor scale_frame_descriptor_t;     // See scale_frame.h
 
 
 // Abstracted base class
@@ -16,6 +23,9 @@ typedef struct {
     // Basic functions
     void (*read_loop_task)(void *self);
     void (*force_zero)(void);
+
+    // Frame layout used by scale_frame_listener_task
+    const scale_frame_descriptor_t * frame_descriptor;
 } scale_handle_t;
 
 
@@ -23,9 +33,16 @@ typedef enum {
     BAUDRATE_4800 = 0,
     BAUDRATE_9600 = 1,
     BAUDRATE_19200 = 2,
+    BAUDRATE_38400 = 3,
 } scale_baudrate_t;
 
 
+typedef enum {
+    SCALE_FRAMING_8N1 = 0,
+    SCALE_FRAMING_7E1 = 1,
+} scale_framing_t;
+
+
 typedef enum {
     SCALE_DRIVER_AND_FXI = 0,
     SCALE_DRIVER_STEINBERG_SBS = 1,
@@ -47,16 +64,36 @@ typedef struct {
     uint16_t scale_data_rev;
     scale_driver_t scale_driver;
     scale_baudrate_t scale_baudrate;
+    scale_framing_t scale_framing;      // Detected by scale_autoconfig_run()
 } eeprom_scale_data_t;
 
 
+typedef enum {
+    SCALE_STABILITY_UNKNOWN = 0,        // The driver doesn't report stability
+    SCALE_STABILITY_STABLE = 1,
+    SCALE_STABILITY_UNSTABLE = 2,
+} scale_stability_t;
+
+
+// One weight frame as received from the scale
+typedef struct {
+    weight_fixed_t weight;              // WEIGHT_FIXED_NAN if the frame can't be decoded
+    uint32_t tick_us;                   // time_us_32() when the last byte of the frame was received
+    scale_stability_t stability;
+    uint32_t seq;                       // Starts from 1, 0 means no measurement
+} scale_measurement_t;
+
+
 typedef struct {
     eeprom_scale_data_t persistent_config;
     scale_handle_t * scale_handle;
-    SemaphoreHandle_t scale_measurement_ready;
+    EventGroupHandle_t scale_measurement_event;  // Wakes every waiter on a new measurement
     SemaphoreHandle_t scale_serial_write_access_mutex;
-    SemaphoreHandle_t scale_measurement_mutex;  // Protects current_scale_measurement
-    float current_scale_measurement;
+
+    // Single producer (the driver task), multiple consumer ring of measurements. Each
+    // slot is guarded by its own sequence number so readers never take a lock.
+    scale_measurement_t measurement_stream[SCALE_MEASUREMENT_STREAM_LEN];
+    volatile uint32_t latest_measurement_seq;
 } scale_config_t;
 
 
@@ -68,13 +105,22 @@ extern "C" {
 bool scale_init();
 
 float scale_get_current_measurement();
-void scale_set_current_measurement(float value);  // Thread-safe setter
 bool scale_block_wait_for_next_measurement(uint32_t block_time_ms, float * current_measurement);
 
+// Measurement stream
+void scale_publish_measurement(weight_fixed_t weight, scale_stability_t stability, uint32_t rx_time_us);  // Called by scale drivers
+uint32_t scale_get_latest_seq(void);
+bool scale_get_latest_measurement(scale_measurement_t * measurement);
+size_t scale_read_since(uint32_t seq, scale_measurement_t * measurements, size_t max_len);
+bool scale_wait_for_measurement_since(uint32_t seq, uint32_t block_time_ms, scale_measurement_t * measurement);
+
 void set_scale_driver(scale_driver_t scale_driver);
 
 const char * get_scale_driver_string();
 
+uint32_t get_scale_baudrate(scale_baudrate_t scale_baudrate);
+void scale_uart_set_framing(scale_framing_t scale_framing);
+
 bool scale_config_save(void);
 
 // Low lever handler for writing data to the scale
@@ -0,0 +1,133 @@
+// Scale auto-baud and continuous output configuration
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hardware/uart.h"
+#include "configuration.h"
+#include "scale.h"
+#include "scale_frame.h"
+#include "scale_uart_rx.h"
+#include "scale_autoconfig.h"
+
+
+#define SCALE_AUTOCONFIG_PROBE_MS           1000        // Long enough for the slowest continuous output rate
+
+
+// 8N1 is what every driver used so far, 7E1 is the factory default on A&D
+static const scale_framing_t framings[] = {
+    SCALE_FRAMING_8N1,
+    SCALE_FRAMING_7E1,
+};
+
+static const char * framing_names[] = {
+    [SCALE_FRAMING_8N1] = "8N1",
+    [SCALE_FRAMING_7E1] = "7E1",
+};
+
+// Fastest first, the faster the scale talks the tighter the control loop
+static const scale_baudrate_t baudrates[] = {
+    BAUDRATE_38400,
+    BAUDRATE_19200,
+    BAUDRATE_9600,
+    BAUDRATE_4800,
+};
+
+extern scale_config_t scale_config;
+
+
+static void _apply_uart_settings(scale_baudrate_t baudrate, scale_framing_t framing) {
+    uint actual_baudrate = uart_set_baudrate(SCALE_UART, get_scale_baudrate(baudrate));
+    scale_uart_set_framing(framing);
+    scale_uart_rx_set_baudrate(actual_baudrate);
+
+    // Bytes received at the old settings are garbage
+    scale_uart_rx_flush();
+}
+
+
+static bool _probe(const scale_frame_descriptor_t * descriptor) {
+    scale_frame_buffer_t buffer = {.len = 0};
+    TickType_t start_tick = xTaskGetTickCount();
+    TickType_t probe_ticks = pdMS_TO_TICKS(SCALE_AUTOCONFIG_PROBE_MS);
+
+    // Ask for continuous output at these settings. Harmless if the scale is already streaming, or talking at
+    // another baud rate.
+    if (descriptor->continuous_output_command) {
+        scale_write(descriptor->continuous_output_command, strlen(descriptor->continuous_output_command));
+    }
+
+    while (xTaskGetTickCount() - start_tick < probe_ticks) {
+        if (descriptor->poll_command) {
+            scale_write(descriptor->poll_command, strlen(descriptor->poll_command));
+        }
+
+        scale_uart_rx_wait_for_frame(descriptor->poll_command ? descriptor->poll_period_ms : 100);
+
+        char ch;
+        while (scale_uart_rx_getc(&ch, NULL)) {
+            if (!scale_frame_push_byte(descriptor, &buffer, ch)) {
+                continue;
+            }
+
+            // A frame of the right length, header and terminator with a number in it won't come out of a
+            // mismatched baud rate
+            scale_frame_reading_t reading;
+            if (scale_frame_decode(descriptor, buffer.bytes, &reading) && weight_is_valid(reading.weight)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+bool scale_autoconfig_run(const scale_frame_descriptor_t * descriptor) {
+    scale_baudrate_t configured_baudrate = scale_config.persistent_config.scale_baudrate;
+    scale_framing_t configured_framing = scale_config.persistent_config.scale_framing;
+
+    for (size_t framing_idx = 0; framing_idx <= sizeof(framings) / sizeof(framings[0]); framing_idx++) {
+        // Configured framing first, then the others
+        scale_framing_t framing = configured_framing;
+        if (framing_idx > 0) {
+            framing = framings[framing_idx - 1];
+            if (framing == configured_framing) {
+                continue;
+            }
+        }
+
+        for (size_t baudrate_idx = 0; baudrate_idx <= sizeof(baudrates) / sizeof(baudrates[0]); baudrate_idx++) {
+            // Configured baud rate first, then the others
+            scale_baudrate_t baudrate = configured_baudrate;
+            if (baudrate_idx > 0) {
+                baudrate = baudrates[baudrate_idx - 1];
+                if (baudrate == configured_baudrate || baudrate > descriptor->max_baudrate) {
+                    continue;
+                }
+            }
+
+            _apply_uart_settings(baudrate, framing);
+            if (!_probe(descriptor)) {
+                continue;
+            }
+
+            printf("Scale found at %lu %s\n", get_scale_baudrate(baudrate), framing_names[framing]);
+
+            if (baudrate != configured_baudrate || framing != configured_framing) {
+                scale_config.persistent_config.scale_baudrate = baudrate;
+                scale_config.persistent_config.scale_framing = framing;
+                scale_config_save();
+            }
+
+            return true;
+        }
+    }
+
+    // Nothing answered, the scale may simply be off. Carry on with what the user configured.
+    printf("Scale not detected, using configured baud rate\n");
+    _apply_uart_settings(configured_baudrate, configured_framing);
+
+    return false;
+}
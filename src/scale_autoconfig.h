@@ -0,0 +1,31 @@
+#ifndef SCALE_AUTOCONFIG_H_
+#define SCALE_AUTOCONFIG_H_
+
+#include <stdbool.h>
+
+#include "scale_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+    Find the baud rate and framing the scale is talking at and switch it to continuous output.
+
+    The configured baud rate and framing are tried first, so a correctly configured scale costs one frame. A
+    detected baud rate or framing that differs from the configuration is saved to EEPROM, so the next boot
+    doesn't probe again. If the scale doesn't answer at all (e.g. it is turned off) the configured settings are
+    restored and false is returned.
+
+    Only the controller side follows the scale. None of the supported scales takes its own baud rate over the
+    serial port (on A&D it is set in the function table), so it is left to the user.
+
+    Must be called from the scale driver task after scale_uart_rx_register_listener().
+*/
+bool scale_autoconfig_run(const scale_frame_descriptor_t * descriptor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SCALE_AUTOCONFIG_H_
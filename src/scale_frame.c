@@ -0,0 +1,118 @@
+// Table-driven frame assembly and decoding shared by all scale drivers.
+//
+// Every supported scale sends a fixed-layout ASCII frame. A driver only describes the layout with a
+// scale_frame_descriptor_t and this module assembles, validates and decodes the frames. The weight is parsed
+// straight into a fixed point weight, so decoding doesn't depend on strtof() and never allocates.
+#include <FreeRTOS.h>
+#include <task.h>
+#include <string.h>
+
+#include "scale.h"
+#include "scale_frame.h"
+#include "scale_uart_rx.h"
+#include "scale_autoconfig.h"
+
+
+bool scale_frame_push_byte(const scale_frame_descriptor_t * descriptor, scale_frame_buffer_t * buffer, char ch) {
+    if (descriptor->sync_char != SCALE_FRAME_NO_SYNC && ch == (char) descriptor->sync_char) {
+        buffer->len = 0;
+    }
+
+    // Keep counting past the frame length so an over-long frame is never mistaken as complete
+    if (buffer->len < descriptor->frame_len) {
+        buffer->bytes[buffer->len] = ch;
+    }
+    if (buffer->len <= descriptor->frame_len) {
+        buffer->len++;
+    }
+
+    if (ch == descriptor->terminator) {
+        bool is_complete = buffer->len == descriptor->frame_len;
+        buffer->len = 0;
+        return is_complete;
+    }
+
+    return false;
+}
+
+
+bool scale_frame_decode(const scale_frame_descriptor_t * descriptor, const char * frame, scale_frame_reading_t * reading) {
+    if (descriptor->header && memcmp(frame, descriptor->header, descriptor->header_len) != 0) {
+        return false;
+    }
+
+    // Weight
+    if (weight_parse(&frame[descriptor->weight_offset], descriptor->weight_len, &reading->weight)) {
+        if (descriptor->sign_offset != SCALE_FRAME_FIELD_NONE && frame[descriptor->sign_offset] == '-') {
+            reading->weight = -reading->weight;
+        }
+    }
+    else {
+        reading->weight = WEIGHT_FIXED_NAN;
+    }
+
+    // Stability
+    if (descriptor->stability_offset == SCALE_FRAME_FIELD_NONE) {
+        reading->stability = SCALE_STABILITY_UNKNOWN;
+    }
+    else if (frame[descriptor->stability_offset] == descriptor->stable_char) {
+        reading->stability = SCALE_STABILITY_STABLE;
+    }
+    else {
+        reading->stability = SCALE_STABILITY_UNSTABLE;
+    }
+
+    // Unit
+    uint8_t unit_len = 0;
+    if (descriptor->unit_offset != SCALE_FRAME_FIELD_NONE) {
+        unit_len = descriptor->unit_len > SCALE_FRAME_MAX_UNIT_LEN ? SCALE_FRAME_MAX_UNIT_LEN : descriptor->unit_len;
+        memcpy(reading->unit, &frame[descriptor->unit_offset], unit_len);
+    }
+    reading->unit[unit_len] = '\0';
+
+    return true;
+}
+
+
+void scale_frame_listener_task(void *self) {
+    const scale_frame_descriptor_t * descriptor = ((scale_handle_t *) self)->frame_descriptor;
+    scale_frame_buffer_t buffer = {.len = 0};
+    TickType_t last_poll_tick = xTaskGetTickCount();
+
+    // Wake up on every complete frame rather than polling the UART
+    scale_uart_rx_register_listener(descriptor->frame_len, descriptor->terminator);
+
+    // Find the scale's baud rate and framing, and turn on continuous output where supported
+    scale_autoconfig_run(descriptor);
+    last_poll_tick = xTaskGetTickCount();
+
+    while (true) {
+        if (descriptor->poll_command) {
+            scale_write(descriptor->poll_command, strlen(descriptor->poll_command));
+
+            // Wait for the response, or give up and send the next request when the poll period is over
+            scale_uart_rx_wait_for_frame(descriptor->poll_period_ms);
+        }
+
+        char ch;
+        uint32_t rx_time_us;
+        while (scale_uart_rx_getc(&ch, &rx_time_us)) {
+            if (!scale_frame_push_byte(descriptor, &buffer, ch)) {
+                continue;
+            }
+
+            scale_frame_reading_t reading;
+            if (scale_frame_decode(descriptor, buffer.bytes, &reading)) {
+                scale_publish_measurement(reading.weight, reading.stability, rx_time_us);
+            }
+        }
+
+        if (descriptor->poll_command) {
+            vTaskDelayUntil(&last_poll_tick, pdMS_TO_TICKS(descriptor->poll_period_ms));
+        }
+        else {
+            // Sleep until the RX interrupt has received a complete frame
+            scale_uart_rx_wait_for_frame(0);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef SCALE_FRAME_H_
+#define SCALE_FRAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scale.h"
+#include "weight.h"
+
+#define SCALE_FRAME_MAX_LEN                     32
+#define SCALE_FRAME_MAX_UNIT_LEN                3
+#define SCALE_FRAME_FIELD_NONE                  0xFF           // Offset of an absent field
+#define SCALE_FRAME_NO_SYNC                     -1
+
+
+/*
+    Declarative description of a fixed-layout scale frame. Offsets are in bytes from the start of the frame
+    and the frame always ends with the terminator.
+*/
+struct scale_frame_descriptor {
+    uint8_t frame_len;                  // Including the terminator
+    char terminator;
+    int16_t sync_char;                  // A byte that always starts a new frame, or SCALE_FRAME_NO_SYNC
+
+    const char * header;                // Expected leading bytes, NULL to accept any
+    uint8_t header_len;
+
+    uint8_t sign_offset;                // Separate '-' sign character, or SCALE_FRAME_FIELD_NONE
+    uint8_t weight_offset;              // Decimal number, may be space padded and carry its own sign
+    uint8_t weight_len;
+
+    uint8_t stability_offset;           // Or SCALE_FRAME_FIELD_NONE if the scale doesn't report stability
+    char stable_char;                   // Any other character at stability_offset means unstable
+
+    uint8_t unit_offset;                // Or SCALE_FRAME_FIELD_NONE
+    uint8_t unit_len;
+
+    // Scales that don't stream continuously are polled with this command
+    const char * poll_command;
+    uint32_t poll_period_ms;
+
+    // Puts the scale into its fastest continuous output mode, NULL if not supported
+    const char * continuous_output_command;
+
+    // Fastest baud rate the scale supports, the auto-baud probe doesn't try beyond
+    scale_baudrate_t max_baudrate;
+};
+
+
+typedef struct {
+    weight_fixed_t weight;              // WEIGHT_FIXED_NAN if the weight field can't be decoded (e.g. overload)
+    scale_stability_t stability;
+    char unit[SCALE_FRAME_MAX_UNIT_LEN + 1];
+} scale_frame_reading_t;
+
+
+typedef struct {
+    uint8_t len;
+    char bytes[SCALE_FRAME_MAX_LEN];
+} scale_frame_buffer_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Generic scale listener task, self is the scale_handle_t with the frame descriptor
+void scale_frame_listener_task(void *self);
+
+// Feed one received byte, returns true once buffer holds a complete frame
+bool scale_frame_push_byte(const scale_frame_descriptor_t * descriptor, scale_frame_buffer_t * buffer, char ch);
+
+// Returns false if the frame is not a measurement frame (header mismatch)
+bool scale_frame_decode(const scale_frame_descriptor_t * descriptor, const char * frame, scale_frame_reading_t * reading);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SCALE_FRAME_H_
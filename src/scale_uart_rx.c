@@ -0,0 +1,166 @@
+// Interrupt driven receive engine shared by all scale drivers.
+//
+// The UART RX interrupt drains the hardware FIFO into a software ring and timestamps each byte. The driver
+// task sleeps on a task notification that is only given when a complete frame (or the terminator) has
+// arrived, so the weight is decoded within an interrupt latency of the last byte instead of up to one
+// polling period later.
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hardware/uart.h"
+#include "hardware/irq.h"
+#include "pico/time.h"
+#include "configuration.h"
+#include "scale_uart_rx.h"
+
+
+#define SCALE_UART_RX_BUFFER_MASK           (SCALE_UART_RX_BUFFER_LEN - 1)
+#define SCALE_UART_HW_FIFO_LEN              32
+#define SCALE_UART_RX_TIMEOUT_BIT_PERIODS   32          // PL011 receive timeout
+#define SCALE_UART_BITS_PER_BYTE            10          // 8N1 or 7E1
+
+
+typedef struct {
+    char ch;
+    uint32_t rx_time_us;
+} scale_uart_rx_byte_t;
+
+
+// Single producer (IRQ), single consumer (the scale driver task)
+static scale_uart_rx_byte_t rx_buffer[SCALE_UART_RX_BUFFER_LEN];
+static volatile uint32_t rx_head = 0;
+static volatile uint32_t rx_tail = 0;
+static volatile uint32_t rx_overflow_count = 0;
+
+// Frame detection
+static TaskHandle_t listener_task_handle = NULL;
+static uint8_t listener_frame_len = 0;
+static int16_t listener_terminator = SCALE_UART_RX_NO_TERMINATOR;
+static uint8_t frame_byte_count = 0;
+
+// Used to back-date bytes that waited in the hardware FIFO
+static uint32_t byte_time_us = 0;
+static uint32_t rx_timeout_us = 0;
+
+
+static void _scale_uart_rx_irq_handler(void) {
+    uint32_t now_us = time_us_32();
+    uart_hw_t * uart_hw = uart_get_hw(SCALE_UART);
+
+    // The receive timeout fires 32 bit periods after the last byte, otherwise the FIFO level was just reached
+    bool is_rx_timeout = (uart_hw->mis & UART_UARTMIS_RTMIS_BITS) != 0;
+
+    char fifo[SCALE_UART_HW_FIFO_LEN];
+    uint32_t fifo_len = 0;
+    while (uart_is_readable(SCALE_UART) && fifo_len < SCALE_UART_HW_FIFO_LEN) {
+        fifo[fifo_len++] = (char) (uart_hw->dr & 0xFF);
+    }
+
+    uint32_t last_byte_us = is_rx_timeout ? now_us - rx_timeout_us : now_us;
+    bool is_frame_complete = false;
+
+    uint32_t head = rx_head;
+    uint32_t tail = __atomic_load_n(&rx_tail, __ATOMIC_ACQUIRE);
+
+    for (uint32_t idx = 0; idx < fifo_len; idx++) {
+        char ch = fifo[idx];
+
+        if (head - tail == SCALE_UART_RX_BUFFER_LEN) {
+            rx_overflow_count += 1;
+        }
+        else {
+            rx_buffer[head & SCALE_UART_RX_BUFFER_MASK].ch = ch;
+            rx_buffer[head & SCALE_UART_RX_BUFFER_MASK].rx_time_us = last_byte_us - (fifo_len - 1 - idx) * byte_time_us;
+            head += 1;
+        }
+
+        frame_byte_count += 1;
+        if ((listener_terminator != SCALE_UART_RX_NO_TERMINATOR && ch == (char) listener_terminator) ||
+            (listener_frame_len != 0 && frame_byte_count >= listener_frame_len)) {
+            frame_byte_count = 0;
+            is_frame_complete = true;
+        }
+    }
+
+    __atomic_store_n(&rx_head, head, __ATOMIC_RELEASE);
+
+    if (is_frame_complete && listener_task_handle) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(listener_task_handle, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+}
+
+
+void scale_uart_rx_set_baudrate(uint32_t baudrate) {
+    byte_time_us = (SCALE_UART_BITS_PER_BYTE * 1000000u) / baudrate;
+    rx_timeout_us = (SCALE_UART_RX_TIMEOUT_BIT_PERIODS * 1000000u) / baudrate;
+}
+
+
+void scale_uart_rx_init(uint32_t baudrate) {
+    scale_uart_rx_set_baudrate(baudrate);
+
+    rx_head = 0;
+    rx_tail = 0;
+    rx_overflow_count = 0;
+
+    uart_set_fifo_enabled(SCALE_UART, true);
+
+    uint irq_num = uart_get_index(SCALE_UART) == 0 ? UART0_IRQ : UART1_IRQ;
+    irq_set_exclusive_handler(irq_num, _scale_uart_rx_irq_handler);
+    irq_set_enabled(irq_num, true);
+
+    // Fires at the lowest FIFO level (4 bytes) or on receive timeout, whichever comes first
+    uart_set_irq_enables(SCALE_UART, true, false);
+}
+
+
+void scale_uart_rx_register_listener(uint8_t frame_len, int16_t terminator) {
+    listener_frame_len = frame_len;
+    listener_terminator = terminator;
+    frame_byte_count = 0;
+
+    // Set the handle last, the IRQ only notifies once the format is in place
+    __atomic_store_n(&listener_task_handle, xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+}
+
+
+void scale_uart_rx_flush(void) {
+    __atomic_store_n(&rx_tail, __atomic_load_n(&rx_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+
+    // Drop any pending frame notification too
+    ulTaskNotifyTake(pdTRUE, 0);
+}
+
+
+bool scale_uart_rx_wait_for_frame(uint32_t block_time_ms) {
+    TickType_t delay_ticks = (block_time_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(block_time_ms);
+
+    return ulTaskNotifyTake(pdTRUE, delay_ticks) > 0;
+}
+
+
+bool scale_uart_rx_getc(char * ch, uint32_t * rx_time_us) {
+    uint32_t tail = rx_tail;
+
+    if (tail == __atomic_load_n(&rx_head, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    *ch = rx_buffer[tail & SCALE_UART_RX_BUFFER_MASK].ch;
+    if (rx_time_us) {
+        *rx_time_us = rx_buffer[tail & SCALE_UART_RX_BUFFER_MASK].rx_time_us;
+    }
+
+    __atomic_store_n(&rx_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+
+uint32_t scale_uart_rx_get_overflow_count(void) {
+    return rx_overflow_count;
+}
@@ -0,0 +1,41 @@
+#ifndef SCALE_UART_RX_H_
+#define SCALE_UART_RX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCALE_UART_RX_BUFFER_LEN                256            // Must be power of two
+#define SCALE_UART_RX_NO_TERMINATOR             -1
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Install the RX interrupt on the scale UART. Must be called after uart_init().
+void scale_uart_rx_init(uint32_t baudrate);
+
+// Update the byte timing after the baud rate has been changed with uart_set_baudrate()
+void scale_uart_rx_set_baudrate(uint32_t baudrate);
+
+// Discard everything received so far. Must be called from the scale driver task.
+void scale_uart_rx_flush(void);
+
+// Called by the scale driver task to receive frame notifications. The driver is woken once frame_len bytes
+// have been received since the last terminator, or when the terminator is received.
+void scale_uart_rx_register_listener(uint8_t frame_len, int16_t terminator);
+
+// Block until a complete frame (or terminator) has been received. Returns false on timeout.
+bool scale_uart_rx_wait_for_frame(uint32_t block_time_ms);
+
+// Non-blocking read of one byte and the time_us_32() when it was received. Returns false if empty.
+bool scale_uart_rx_getc(char * ch, uint32_t * rx_time_us);
+
+// Number of bytes dropped because the driver fell behind
+uint32_t scale_uart_rx_get_overflow_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SCALE_UART_RX_H_
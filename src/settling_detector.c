@@ -0,0 +1,97 @@
+#include <math.h>
+#include <string.h>
+
+#include "settling_detector.h"
+
+
+void settling_detector_get_default_config(settling_detector_config_t * config, float sd_threshold) {
+    config->alpha = 0.3f;
+    config->sd_threshold = sd_threshold;
+
+    // The slope is taken from the smoothed mean, a residual drift of 2 SD per second settles within the
+    // next couple of frames
+    config->slope_threshold = 2.0f * sd_threshold;
+
+    // Classic CUSUM tuning, k = 0.5 sigma and h = 4 sigma
+    config->cusum_drift = 0.5f * sd_threshold;
+    config->cusum_threshold = 4.0f * sd_threshold;
+
+    config->min_samples = 4;
+}
+
+
+static void _restart(settling_detector_t * detector, float weight) {
+    detector->sample_count = 1;
+    detector->mean = weight;
+    detector->variance = 0.0f;
+    detector->slope = 0.0f;
+    detector->cusum_pos = 0.0f;
+    detector->cusum_neg = 0.0f;
+    detector->is_stable = false;
+}
+
+
+void settling_detector_init(settling_detector_t * detector, const settling_detector_config_t * config, uint32_t start_us) {
+    memset(detector, 0x0, sizeof(settling_detector_t));
+    detector->config = *config;
+    detector->start_us = start_us;
+}
+
+
+bool settling_detector_update(settling_detector_t * detector, float weight, uint32_t tick_us) {
+    const settling_detector_config_t * config = &detector->config;
+
+    if (detector->sample_count == 0) {
+        _restart(detector, weight);
+        detector->last_sample_us = tick_us;
+        return false;
+    }
+
+    // Step detection against the mean so far
+    float deviation = weight - detector->mean;
+    detector->cusum_pos = fmaxf(0.0f, detector->cusum_pos + deviation - config->cusum_drift);
+    detector->cusum_neg = fmaxf(0.0f, detector->cusum_neg - deviation - config->cusum_drift);
+
+    if (detector->cusum_pos > config->cusum_threshold || detector->cusum_neg > config->cusum_threshold) {
+        // Start over from the new level rather than letting the EWMA crawl towards it
+        detector->step_count += 1;
+        _restart(detector, weight);
+        detector->last_sample_us = tick_us;
+        return false;
+    }
+
+    // Noise
+    float mean_change = config->alpha * deviation;
+    detector->mean += mean_change;
+    detector->variance = (1.0f - config->alpha) * (detector->variance + config->alpha * deviation * deviation);
+
+    // Drift, from the smoothed mean so quantisation steps don't dominate
+    float dt_s = (tick_us - detector->last_sample_us) * 1e-6f;
+    if (dt_s > 0.0f) {
+        detector->slope += config->alpha * (mean_change / dt_s - detector->slope);
+    }
+
+    detector->last_sample_us = tick_us;
+    detector->sample_count += 1;
+
+    bool is_stable = detector->sample_count >= config->min_samples &&
+                     settling_detector_get_sd(detector) < config->sd_threshold &&
+                     fabsf(detector->slope) < config->slope_threshold;
+
+    if (is_stable && !detector->is_stable) {
+        detector->time_to_stable_ms = (tick_us - detector->start_us) / 1000;
+    }
+    detector->is_stable = is_stable;
+
+    return is_stable;
+}
+
+
+float settling_detector_get_mean(const settling_detector_t * detector) {
+    return detector->mean;
+}
+
+
+float settling_detector_get_sd(const settling_detector_t * detector) {
+    return sqrtf(detector->variance);
+}
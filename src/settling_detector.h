@@ -0,0 +1,75 @@
+#ifndef SETTLING_DETECTOR_H_
+#define SETTLING_DETECTOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Online settling detector for scale readings
+ *
+ * Tracks the reading with an exponentially weighted mean and variance (noise)
+ * and an exponentially weighted slope (drift). A two sided CUSUM on the
+ * deviation from the mean catches steps that the EWMA would average away, e.g.
+ * the cup being put back or powder still landing.
+ *
+ * The reading is declared settled once enough samples have been seen since the
+ * last step, the noise SD and the drift are both below their thresholds, and
+ * the CUSUM hasn't fired. Unlike a fixed N-sample window this finishes as soon
+ * as the scale is actually quiet.
+ *
+ * Usage:
+ * 1. settling_detector_init(&detector, &config, time_us_32())
+ * 2. Call settling_detector_update() with every measurement
+ * 3. Once it returns true, settling_detector_get_mean() is the settled weight
+ *    and time_to_stable_ms is how long it took
+ */
+
+typedef struct {
+    float alpha;                  // EWMA smoothing factor for mean, variance and slope (0, 1]
+    float sd_threshold;           // Settled if the noise SD is below
+    float slope_threshold;        // Settled if |drift| is below, in weight per second
+    float cusum_drift;            // CUSUM allowance (k), deviation tolerated per sample
+    float cusum_threshold;        // CUSUM decision threshold (h), a step is detected when exceeded
+    uint8_t min_samples;          // Samples required since the last step, sets the confidence
+} settling_detector_config_t;
+
+typedef struct {
+    settling_detector_config_t config;
+
+    uint32_t start_us;
+    uint32_t last_sample_us;
+    uint32_t sample_count;        // Since the last detected step
+
+    float mean;
+    float variance;
+    float slope;
+
+    float cusum_pos;
+    float cusum_neg;
+    uint32_t step_count;          // Number of steps detected since init
+
+    bool is_stable;
+    uint32_t time_to_stable_ms;   // Valid once is_stable
+} settling_detector_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Derive a configuration from the SD margin the user set for the charge mode
+void settling_detector_get_default_config(settling_detector_config_t * config, float sd_threshold);
+
+void settling_detector_init(settling_detector_t * detector, const settling_detector_config_t * config, uint32_t start_us);
+
+// Returns true once the reading has settled. Stays true until a step is detected.
+bool settling_detector_update(settling_detector_t * detector, float weight, uint32_t tick_us);
+
+float settling_detector_get_mean(const settling_detector_t * detector);
+float settling_detector_get_sd(const settling_detector_t * detector);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SETTLING_DETECTOR_H_
@@ -0,0 +1,149 @@
+// Fixed point weight parsing and formatting.
+//
+// The M0+ has no FPU, so strtof() and printf("%f") are both expensive software float routines. Weights are
+// kept in 1/1000 of the scale unit and converted to and from text with integer arithmetic only.
+#include <stdint.h>
+#include <string.h>
+
+#include "weight.h"
+
+
+bool weight_parse(const char * field, size_t len, weight_fixed_t * weight) {
+    size_t idx = 0;
+    int32_t value = 0;
+    uint8_t decimal_places = 0;
+    bool is_negative = false;
+    bool has_point = false;
+    bool has_digit = false;
+    bool round_up = false;
+
+    // Leading padding
+    while (idx < len && field[idx] == ' ') {
+        idx++;
+    }
+
+    if (idx < len && (field[idx] == '-' || field[idx] == '+')) {
+        is_negative = field[idx] == '-';
+        idx++;
+
+        // Some scales pad between the sign and the number
+        while (idx < len && field[idx] == ' ') {
+            idx++;
+        }
+    }
+
+    for (; idx < len; idx++) {
+        char ch = field[idx];
+
+        if (ch >= '0' && ch <= '9') {
+            has_digit = true;
+
+            if (!has_point || decimal_places < WEIGHT_FIXED_DECIMAL_PLACES) {
+                if (value > (INT32_MAX - 9) / 10) {
+                    return false;
+                }
+                value = value * 10 + (ch - '0');
+
+                if (has_point) {
+                    decimal_places++;
+                }
+            }
+            else if (decimal_places == WEIGHT_FIXED_DECIMAL_PLACES) {
+                // The first extra decimal decides the rounding, the rest is ignored
+                round_up = ch >= '5';
+                decimal_places++;
+            }
+        }
+        else if (ch == '.' && !has_point) {
+            has_point = true;
+        }
+        else {
+            // End of the number (e.g. the unit or trailing padding)
+            break;
+        }
+    }
+
+    if (!has_digit) {
+        return false;
+    }
+
+    for (; decimal_places < WEIGHT_FIXED_DECIMAL_PLACES; decimal_places++) {
+        if (value > INT32_MAX / 10) {
+            return false;
+        }
+        value *= 10;
+    }
+
+    if (round_up) {
+        if (value == INT32_MAX) {
+            return false;
+        }
+        value += 1;
+    }
+
+    *weight = is_negative ? -value : value;
+
+    return true;
+}
+
+
+int weight_to_string(char * output_str, weight_fixed_t weight, decimal_places_t decimal_places) {
+    uint32_t divisor;
+    uint8_t fraction_len;
+
+    if (!weight_is_valid(weight)) {
+        strcpy(output_str, "nan");
+        return 3;
+    }
+
+    uint32_t magnitude = weight < 0 ? -(uint32_t) weight : (uint32_t) weight;
+
+    switch (decimal_places) {
+        case DP_2:
+            magnitude = (magnitude + 5) / 10;
+            divisor = 100;
+            fraction_len = 2;
+            break;
+        case DP_3:
+            divisor = 1000;
+            fraction_len = 3;
+            break;
+        default:
+            output_str[0] = '\0';
+            return 0;
+    }
+
+    uint32_t integer_part = magnitude / divisor;
+    uint32_t fraction_part = magnitude % divisor;
+
+    // Integer digits come out in reverse order
+    char integer_digits[10];
+    int integer_len = 0;
+    do {
+        integer_digits[integer_len++] = '0' + (integer_part % 10);
+        integer_part /= 10;
+    } while (integer_part);
+
+    int len = 0;
+
+    // No "-0.00" when a small negative weight rounds to zero
+    if (weight < 0 && magnitude != 0) {
+        output_str[len++] = '-';
+    }
+
+    while (integer_len) {
+        output_str[len++] = integer_digits[--integer_len];
+    }
+
+    output_str[len++] = '.';
+
+    for (int idx = fraction_len - 1; idx >= 0; idx--) {
+        output_str[len + idx] = '0' + (fraction_part % 10);
+        fraction_part /= 10;
+    }
+    len += fraction_len;
+
+    output_str[len] = '\0';
+
+    return len;
+}
@@ -0,0 +1,57 @@
+#ifndef WEIGHT_H_
+#define WEIGHT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "common.h"
+
+// Weight in 1/1000 of the scale unit (milligrains, milligrams, ...). int32 covers +/- 2 million units,
+// beyond the capacity of any supported scale.
+typedef int32_t weight_fixed_t;
+
+#define WEIGHT_FIXED_SCALE                      1000
+#define WEIGHT_FIXED_DECIMAL_PLACES             3
+#define WEIGHT_FIXED_NAN                        INT32_MIN      // Not a weight (overload, decode error, ...)
+#define WEIGHT_FIXED_MAX_STRING_LEN             13             // "-2147483.647" and the null terminator
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline bool weight_is_valid(weight_fixed_t weight) {
+    return weight != WEIGHT_FIXED_NAN;
+}
+
+static inline float weight_to_float(weight_fixed_t weight) {
+    if (!weight_is_valid(weight)) {
+        return NAN;
+    }
+    return (float) weight / WEIGHT_FIXED_SCALE;
+}
+
+static inline weight_fixed_t weight_from_float(float weight) {
+    float scaled = weight * WEIGHT_FIXED_SCALE;
+
+    // Also catches NAN, which fails every comparison
+    if (!(scaled > (float) INT32_MIN && scaled < (float) INT32_MAX)) {
+        return WEIGHT_FIXED_NAN;
+    }
+    return (weight_fixed_t) (scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+// Parse a space padded decimal number (e.g. "  -12.3456"), rounded to 3 decimal places. Parsing stops at the
+// first character that isn't part of the number. Returns false if no digit is found or on overflow.
+bool weight_parse(const char * field, size_t len, weight_fixed_t * weight);
+
+// Format with 2 or 3 decimal places (rounded half away from zero), "nan" if not valid. Returns the string length.
+int weight_to_string(char * output_str, weight_fixed_t weight, decimal_places_t decimal_places);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // WEIGHT_H_
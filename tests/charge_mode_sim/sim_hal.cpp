@@ -0,0 +1,383 @@
+/*
+ * Host shims for the firmware interfaces used by charge_mode.cpp.
+ *
+ * FreeRTOS ticks, the scale driver and the motor driver are backed by the
+ * simulated plant in sim_plant.cpp. Everything the charge loop only touches for
+ * user feedback (display, LEDs, servo gate, EEPROM) is a no-op.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <queue.h>
+#include <semphr.h>
+#include <u8g2.h>
+#include <pico/time.h>
+
+#include "app.h"
+#include "scale.h"
+#include "motors.h"
+#include "servo_gate.h"
+#include "neopixel_led.h"
+#include "mini_12864_module.h"
+#include "display.h"
+#include "eeprom.h"
+// flash_ops.h has no C linkage guard of its own
+extern "C" {
+#include "firmware_update/flash_ops.h"
+}
+#include "sim_plant.h"
+#include "sim_hal.h"
+
+
+// Globals owned by other firmware modules
+scale_config_t scale_config;
+servo_gate_t servo_gate;
+neopixel_led_config_t neopixel_led_config;
+QueueHandle_t encoder_event_queue = NULL;
+AppState_t exit_state = APP_STATE_DEFAULT;
+
+static u8g2_t display_handler;
+static uint64_t motor_stop_us = 0;
+
+
+static void _sim_force_zero(void) {
+    // The simulated scale always starts a drop at zero
+}
+
+static void _sim_read_loop_task(void *p) {
+}
+
+static scale_handle_t sim_scale_handle = {
+    .read_loop_task = _sim_read_loop_task,
+    .force_zero = _sim_force_zero,
+};
+
+
+void sim_hal_init(void) {
+    memset(&scale_config, 0x0, sizeof(scale_config));
+    scale_config.scale_handle = &sim_scale_handle;
+
+    memset(&servo_gate, 0x0, sizeof(servo_gate));
+    servo_gate.gate_state = GATE_DISABLED;
+
+    memset(&neopixel_led_config, 0x0, sizeof(neopixel_led_config));
+}
+
+
+uint64_t sim_hal_get_motor_stop_us(void) {
+    return motor_stop_us;
+}
+
+
+//
+// FreeRTOS
+//
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t) (sim_plant_now_us() / (1000 * portTICK_PERIOD_MS));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim_plant_advance_to(sim_plant_now_us() + (uint64_t) ticks * portTICK_PERIOD_MS * 1000);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake_tick, TickType_t increment) {
+    TickType_t wake_tick = *previous_wake_tick + increment;
+    TickType_t now = xTaskGetTickCount();
+
+    if ((int32_t) (wake_tick - now) > 0) {
+        vTaskDelay(wake_tick - now);
+    }
+    *previous_wake_tick = wake_tick;
+}
+
+BaseType_t xTaskGetSchedulerState(void) {
+    return taskSCHEDULER_RUNNING;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, configSTACK_DEPTH_TYPE stack_depth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *created_task) {
+    // Tasks are never scheduled on the host, hand out a dummy handle
+    if (created_task) {
+        *created_task = (TaskHandle_t) task;
+    }
+    return pdPASS;
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+}
+
+void vTaskResume(TaskHandle_t task) {
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return 1;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return NULL;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    static uint8_t dummy_queue;
+    return &dummy_queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait) {
+    return pdFALSE;
+}
+
+// Single threaded, a mutex is always free
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    static uint8_t dummy_mutex;
+    return &dummy_mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return pdTRUE;
+}
+
+
+//
+// Pico SDK
+//
+void busy_wait_us(uint64_t delay_us) {
+    sim_plant_advance_to(sim_plant_now_us() + delay_us);
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t) sim_plant_now_us();
+}
+
+uint64_t time_us_64(void) {
+    return sim_plant_now_us();
+}
+
+
+//
+// Scale
+//
+static bool _sim_wait_for_frame(uint32_t block_time_ms) {
+    // Block time 0 waits indefinitely, but the simulated scale always produces a frame within a period
+    uint64_t deadline_us = sim_plant_now_us() + (block_time_ms ? block_time_ms : 10000) * 1000ULL;
+
+    sim_scale_frame_t frame;
+    if (!sim_plant_wait_for_frame(deadline_us, &frame)) {
+        return false;
+    }
+
+    // Stands in for scale_publish_measurement() from the driver task
+    scale_measurement_t * slot = &scale_config.measurement_stream[(scale_config.latest_measurement_seq + 1) %
+                                                                  SCALE_MEASUREMENT_STREAM_LEN];
+    slot->weight = weight_from_float(frame.weight);
+    slot->tick_us = (uint32_t) frame.arrival_us;
+    slot->stability = SCALE_STABILITY_UNKNOWN;
+    slot->seq = scale_config.latest_measurement_seq + 1;
+    scale_config.latest_measurement_seq = slot->seq;
+
+    return true;
+}
+
+float scale_get_current_measurement() {
+    return sim_plant_get_last_reading();
+}
+
+uint32_t scale_get_latest_seq(void) {
+    return scale_config.latest_measurement_seq;
+}
+
+bool scale_get_latest_measurement(scale_measurement_t * measurement) {
+    if (scale_config.latest_measurement_seq == 0) {
+        return false;
+    }
+    *measurement = scale_config.measurement_stream[scale_config.latest_measurement_seq % SCALE_MEASUREMENT_STREAM_LEN];
+    return true;
+}
+
+size_t scale_read_since(uint32_t seq, scale_measurement_t * measurements, size_t max_len) {
+    uint32_t latest_seq = scale_config.latest_measurement_seq;
+    size_t len = 0;
+
+    if (latest_seq - seq > SCALE_MEASUREMENT_STREAM_LEN - 1) {
+        seq = latest_seq - (SCALE_MEASUREMENT_STREAM_LEN - 1);
+    }
+    while (len < max_len && seq != latest_seq) {
+        seq++;
+        measurements[len++] = scale_config.measurement_stream[seq % SCALE_MEASUREMENT_STREAM_LEN];
+    }
+
+    return len;
+}
+
+bool scale_wait_for_measurement_since(uint32_t seq, uint32_t block_time_ms, scale_measurement_t * measurement) {
+    if (scale_read_since(seq, measurement, 1) == 1) {
+        return true;
+    }
+    return _sim_wait_for_frame(block_time_ms) && scale_read_since(seq, measurement, 1) == 1;
+}
+
+bool scale_block_wait_for_next_measurement(uint32_t block_time_ms, float * current_measurement) {
+    if (!_sim_wait_for_frame(block_time_ms)) {
+        return false;
+    }
+
+    *current_measurement = scale_get_current_measurement();
+    return true;
+}
+
+
+//
+// Motors
+//
+void motor_set_speed(motor_select_t selected_motor, float new_velocity) {
+    if (selected_motor == SELECT_COARSE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
+        sim_plant_set_motor_speed(SELECT_COARSE_TRICKLER_MOTOR, new_velocity);
+    }
+    if (selected_motor == SELECT_FINE_TRICKLER_MOTOR || selected_motor == SELECT_BOTH_MOTOR) {
+        sim_plant_set_motor_speed(SELECT_FINE_TRICKLER_MOTOR, new_velocity);
+
+        // The fine trickler is only commanded to 0 when the charge completes
+        if (new_velocity == 0) {
+            motor_stop_us = sim_plant_now_us();
+        }
+    }
+}
+
+uint16_t get_motor_max_speed(motor_select_t selected_motor) {
+    return 5;
+}
+
+float get_motor_min_speed(motor_select_t selected_motor) {
+    return 0.1f;
+}
+
+// Same unit as the firmware, 1/256 of a step of a 200 step motor driving the trickler directly
+#define SIM_POSITION_STEPS_PER_REV      (200 * 256)
+
+int64_t motor_get_position(motor_select_t selected_motor) {
+    return llround((double) sim_plant_get_motor_position(selected_motor) * SIM_POSITION_STEPS_PER_REV);
+}
+
+float motor_get_revs_since(motor_select_t selected_motor, int64_t start_position) {
+    return (float) (motor_get_position(selected_motor) - start_position) / SIM_POSITION_STEPS_PER_REV;
+}
+
+float get_motor_acceleration(motor_select_t selected_motor) {
+    sim_plant_config_t plant_config;
+    sim_plant_get_default_config(&plant_config);
+    return plant_config.motor_acceleration_rps2;
+}
+
+void motor_enable(motor_select_t selected_motor, bool enable) {
+    if (!enable) {
+        motor_set_speed(selected_motor, 0);
+    }
+}
+
+
+//
+// User interface and peripherals
+//
+ButtonEncoderEvent_t button_wait_for_input(bool block) {
+    return BUTTON_NO_EVENT;
+}
+
+void neopixel_led_set_colour(rgbw_u32_t mini12864_backlight_colour, rgbw_u32_t led1_colour, rgbw_u32_t led2_colour, bool block_wait) {
+}
+
+uint32_t hex_string_to_decimal(char * string) {
+    return 0;
+}
+
+void servo_gate_set_state(gate_state_t state, bool block_wait) {
+    servo_gate.gate_state = state;
+}
+
+u8g2_t *get_display_handler(void) {
+    return &display_handler;
+}
+
+const uint8_t u8g2_font_helvB08_tr[1] = {0};
+const uint8_t u8g2_font_helvR08_tr[1] = {0};
+const uint8_t u8g2_font_profont22_tf[1] = {0};
+const uint8_t u8g2_font_profont11_tf[1] = {0};
+
+void u8g2_ClearBuffer(u8g2_t *u8g2) {}
+void u8g2_SendBuffer(u8g2_t *u8g2) {}
+void u8g2_SetFont(u8g2_t *u8g2, const uint8_t *font) {}
+uint16_t u8g2_DrawStr(u8g2_t *u8g2, uint16_t x, uint16_t y, const char *str) { return 0; }
+void u8g2_DrawHLine(u8g2_t *u8g2, uint16_t x, uint16_t y, uint16_t w) {}
+uint16_t u8g2_GetStrWidth(u8g2_t *u8g2, const char *s) { return 0; }
+uint16_t u8g2_GetDisplayWidth(u8g2_t *u8g2) { return 128; }
+
+
+//
+// EEPROM (always blank, so every module loads its defaults)
+//
+bool eeprom_read(uint16_t data_addr, uint8_t * data, size_t len) {
+    memset(data, 0xFF, len);
+    return true;
+}
+
+bool eeprom_write(uint16_t data_addr, uint8_t * data, size_t len) {
+    return true;
+}
+
+void eeprom_register_handler(eeprom_save_handler_t handler) {
+}
+
+
+//
+// Flash, NOR semantics: erase sets every bit, programming can only clear them
+//
+static uint8_t sim_flash[FLASH_TOTAL_SIZE];
+static bool is_sim_flash_blank = false;
+
+static void _sim_flash_init() {
+    if (!is_sim_flash_blank) {
+        memset(sim_flash, 0xFF, sizeof(sim_flash));
+        is_sim_flash_blank = true;
+    }
+}
+
+flash_op_result_t flash_erase_region(uint32_t offset, uint32_t size,
+                                     flash_progress_callback_t progress_callback, void *user_data) {
+    _sim_flash_init();
+    memset(&sim_flash[offset], 0xFF, size);
+    return FLASH_OP_SUCCESS;
+}
+
+flash_op_result_t flash_write(uint32_t offset, const uint8_t *data, uint32_t size,
+                              flash_progress_callback_t progress_callback, void *user_data) {
+    _sim_flash_init();
+    for (uint32_t idx = 0; idx < size; idx++) {
+        sim_flash[offset + idx] &= data[idx];
+    }
+    return FLASH_OP_SUCCESS;
+}
+
+flash_op_result_t flash_read(uint32_t offset, uint8_t *data, uint32_t size) {
+    _sim_flash_init();
+    memcpy(data, &sim_flash[offset], size);
+    return FLASH_OP_SUCCESS;
+}
+
+
+//
+// Misc
+//
+extern "C" void swuart_calcCRC(uint8_t* datagram, uint8_t datagramLength) {
+}
+
+void rest_register_handler(char * uri, rest_handler_t f) {
+}
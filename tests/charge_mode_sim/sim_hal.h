@@ -0,0 +1,19 @@
+#ifndef SIM_HAL_H_
+#define SIM_HAL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_hal_init(void);
+
+// Simulated time at which the charge loop last commanded the fine trickler to stop
+uint64_t sim_hal_get_motor_stop_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_HAL_H_
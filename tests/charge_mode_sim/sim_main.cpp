@@ -0,0 +1,237 @@
+/*
+ * Closed-loop trickler simulator
+ *
+ * Runs the real charge_mode_wait_for_complete() against a simulated scale and
+ * tricklers and reports drop time and overthrow distributions.
+ *
+ * Usage:
+ *     charge_mode_sim [--drops N] [--target W] [--seed S] [--csv FILE] [--profile IDX] [--inflight 0|1]
+ *                     [--flow-model 0|1] [--backoff-deg A] [--hang-gr G] [--hang-ms T]
+ *                     [--coarse-gpr G] [--fine-gpr G] [--gpr-slope-pct P] [--fall-ms T] [--frame-ms T]
+ *                     [--jitter-ms T] [--latency-ms T] [--settle-ms T] [--resolution R]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#include "charge_mode.h"
+#include "profile.h"
+#include "scale.h"
+#include "ai_tuning.h"
+#include "sim_plant.h"
+#include "sim_hal.h"
+
+
+extern charge_mode_config_t charge_mode_config;
+void charge_mode_wait_for_complete();
+
+
+typedef struct {
+    float drop_time_s;
+    float landed_weight;
+    float reading_at_stop;
+    float overthrow;
+} sim_drop_result_t;
+
+
+static float _percentile(std::vector<float> values, float pct) {
+    if (values.empty()) {
+        return NAN;
+    }
+    std::sort(values.begin(), values.end());
+    size_t idx = (size_t) lroundf(pct / 100.0f * (values.size() - 1));
+    return values[idx];
+}
+
+
+static void _print_distribution(const char * name, const std::vector<float> & values) {
+    double sum = 0.0;
+    double sum_of_sqre = 0.0;
+    for (float v : values) {
+        sum += v;
+        sum_of_sqre += (double) v * v;
+    }
+    double mean = sum / values.size();
+    double sd = sqrt(fmax(0.0, sum_of_sqre / values.size() - mean * mean));
+
+    printf("%-16s mean %8.3f  sd %7.3f  min %8.3f  p50 %8.3f  p95 %8.3f  max %8.3f\n",
+           name, mean, sd,
+           _percentile(values, 0), _percentile(values, 50),
+           _percentile(values, 95), _percentile(values, 100));
+}
+
+
+static sim_drop_result_t _run_drop(float target_weight) {
+    sim_drop_result_t result;
+
+    sim_plant_reset();
+
+    // Let the scale produce a zero reading first, as charge_mode_wait_for_zero would
+    sim_plant_advance_to(sim_plant_now_us() + 500 * 1000);
+    scale_measurement_t zero_measurement;
+    scale_wait_for_measurement_since(scale_get_latest_seq(), 200, &zero_measurement);
+
+    charge_mode_config.target_charge_weight = target_weight;
+    charge_mode_config.charge_mode_state = CHARGE_MODE_WAIT_FOR_COMPLETE;
+
+    uint64_t start_us = sim_plant_now_us();
+    charge_mode_wait_for_complete();
+    uint64_t stop_us = sim_hal_get_motor_stop_us();
+
+    result.reading_at_stop = sim_plant_get_last_reading();
+
+    // Let all powder land and the scale settle
+    sim_plant_advance_to(sim_plant_now_us() + 3000 * 1000);
+
+    // As charge_mode_wait_for_cup_removal would with the settled reading
+    charge_mode_learn_from_drop(sim_plant_get_last_reading());
+
+    result.drop_time_s = (stop_us - start_us) * 1e-6f;
+    result.landed_weight = sim_plant_get_landed_mass();
+    result.overthrow = result.landed_weight - target_weight;
+
+    return result;
+}
+
+
+int main(int argc, char * argv[]) {
+    uint32_t drops = 1000;
+    uint32_t seed = 1;
+    float target_weight = 40.0f;
+    int profile_idx = 0;
+    bool inflight_compensation_enabled = false;
+    bool flow_model_enabled = false;
+    float coarse_backoff_angle_deg = 0.0f;
+    const char * csv_path = NULL;
+
+    sim_plant_config_t plant_config;
+    sim_plant_get_default_config(&plant_config);
+
+    for (int idx = 1; idx < argc; idx++) {
+        const char * arg = argv[idx];
+        const char * value = (idx + 1 < argc) ? argv[idx + 1] : NULL;
+
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 1;
+        }
+
+        if (strcmp(arg, "--drops") == 0) {
+            drops = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--target") == 0) {
+            target_weight = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--seed") == 0) {
+            seed = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--csv") == 0) {
+            csv_path = value;
+        }
+        else if (strcmp(arg, "--profile") == 0) {
+            profile_idx = atoi(value);
+        }
+        else if (strcmp(arg, "--inflight") == 0) {
+            inflight_compensation_enabled = atoi(value) != 0;
+        }
+        else if (strcmp(arg, "--flow-model") == 0) {
+            flow_model_enabled = atoi(value) != 0;
+        }
+        else if (strcmp(arg, "--backoff-deg") == 0) {
+            coarse_backoff_angle_deg = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--hang-gr") == 0) {
+            plant_config.coarse_hanging_grains = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--hang-ms") == 0) {
+            plant_config.hanging_release_ms = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--coarse-gpr") == 0) {
+            plant_config.coarse_grains_per_rev = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--fine-gpr") == 0) {
+            plant_config.fine_grains_per_rev = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--gpr-slope-pct") == 0) {
+            plant_config.grains_per_rev_slope_pct = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--fall-ms") == 0) {
+            plant_config.fall_time_ms = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--frame-ms") == 0) {
+            plant_config.scale_frame_period_ms = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--jitter-ms") == 0) {
+            plant_config.scale_frame_jitter_ms = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--latency-ms") == 0) {
+            plant_config.scale_latency_ms = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--settle-ms") == 0) {
+            plant_config.scale_settle_tau_ms = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--resolution") == 0) {
+            plant_config.scale_resolution = strtof(value, NULL);
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            return 1;
+        }
+        idx++;
+    }
+
+    // Bring up the firmware modules with their default (blank EEPROM) settings
+    sim_hal_init();
+    sim_plant_init(&plant_config, seed);
+    profile_data_init();
+    profile_select(profile_idx);
+    profile_get_selected()->inflight_compensation_enabled = inflight_compensation_enabled;
+    profile_get_selected()->flow_model_enabled = flow_model_enabled;
+    profile_get_selected()->coarse_backoff_angle_deg = coarse_backoff_angle_deg;
+    charge_mode_config_init();
+    ai_tuning_init();
+
+    FILE * csv = NULL;
+    if (csv_path) {
+        csv = fopen(csv_path, "w");
+        if (csv == NULL) {
+            fprintf(stderr, "Unable to open %s\n", csv_path);
+            return 1;
+        }
+        fprintf(csv, "drop,drop_time_s,reading_at_stop,landed_weight,overthrow\n");
+    }
+
+    std::vector<float> drop_times;
+    std::vector<float> overthrows;
+
+    clock_t wall_start = clock();
+
+    for (uint32_t drop = 0; drop < drops; drop++) {
+        sim_drop_result_t result = _run_drop(target_weight);
+
+        drop_times.push_back(result.drop_time_s);
+        overthrows.push_back(result.overthrow);
+
+        if (csv) {
+            fprintf(csv, "%u,%.4f,%.4f,%.4f,%.4f\n", drop,
+                    result.drop_time_s, result.reading_at_stop, result.landed_weight, result.overthrow);
+        }
+    }
+
+    double wall_s = (double) (clock() - wall_start) / CLOCKS_PER_SEC;
+
+    if (csv) {
+        fclose(csv);
+    }
+
+    printf("Profile: %s, target %.3f, %u drops (%.0f drops/s)\n",
+           profile_get_selected()->name, target_weight, drops, drops / fmax(wall_s, 1e-9));
+    _print_distribution("drop time (s)", drop_times);
+    _print_distribution("overthrow", overthrows);
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include <math.h>
+#include <deque>
+#include <random>
+
+#include "sim_plant.h"
+
+#define SIM_STEP_US     1000        // Plant integration step
+#define HANG_FILL_REVS  0.25f       // Revolutions of a running trickler to build up the hanging powder
+
+
+typedef struct {
+    uint64_t land_us;
+    float mass;
+} falling_powder_t;
+
+
+static sim_plant_config_t plant_config;
+static std::mt19937 rng;
+static std::normal_distribution<float> normal(0.0f, 1.0f);
+static std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+static uint64_t now_us = 0;
+static float commanded_speed[2];
+static float actual_speed[2];
+static double position[2];              // Revolutions since init, kept across drops like the step counter
+
+static std::deque<falling_powder_t> falling_powder;
+static float landed_mass;
+static float in_flight_mass;
+static float hanging_mass;              // Over the end of the coarse tube
+
+static float filtered_mass;
+static float step_alpha;
+static uint64_t next_sample_us;
+static uint64_t last_arrival_us;
+static std::deque<sim_scale_frame_t> pending_frames;
+static float last_reading;
+static bool frame_ready;
+static sim_scale_frame_t ready_frame;
+
+
+void sim_plant_get_default_config(sim_plant_config_t * config) {
+    // Loosely based on an A&D FX-120i at 19200 baud with a stick powder
+    config->coarse_grains_per_rev = 6.0f;
+    config->fine_grains_per_rev = 0.25f;
+    config->grains_per_rev_slope_pct = 0.0f;
+    config->flow_noise_pct = 0.5f;
+    config->motor_acceleration_rps2 = 50.0f;
+    config->fall_time_ms = 120.0f;
+    config->coarse_hanging_grains = 0.0f;
+    config->hanging_release_ms = 1500.0f;
+
+    config->scale_frame_period_ms = 100.0f;
+    config->scale_frame_jitter_ms = 10.0f;
+    config->scale_latency_ms = 150.0f;
+    config->scale_settle_tau_ms = 250.0f;
+    config->scale_resolution = 0.02f;
+    config->scale_noise_sd = 0.005f;
+}
+
+
+void sim_plant_init(const sim_plant_config_t * config, uint32_t seed) {
+    plant_config = *config;
+    rng.seed(seed);
+    step_alpha = 1.0f - expf(-(SIM_STEP_US / 1000.0f) / plant_config.scale_settle_tau_ms);
+    now_us = 0;
+    position[0] = position[1] = 0.0;
+
+    sim_plant_reset();
+}
+
+
+void sim_plant_reset(void) {
+    for (int idx = 0; idx < 2; idx++) {
+        commanded_speed[idx] = 0.0f;
+        actual_speed[idx] = 0.0f;
+    }
+
+    falling_powder.clear();
+    landed_mass = 0.0f;
+    in_flight_mass = 0.0f;
+    hanging_mass = 0.0f;            // Fell into the previous cup
+
+    filtered_mass = 0.0f;
+    pending_frames.clear();
+    last_reading = 0.0f;
+    frame_ready = false;
+
+    // The scale free-runs, so the first frame arrives at a random phase
+    uint64_t period_us = (uint64_t) (plant_config.scale_frame_period_ms * 1000);
+    next_sample_us = now_us + (uint64_t) (uniform(rng) * period_us);
+    last_arrival_us = now_us;
+}
+
+
+uint64_t sim_plant_now_us(void) {
+    return now_us;
+}
+
+
+static float _quantise(float value, float resolution) {
+    if (resolution <= 0) {
+        return value;
+    }
+    return roundf(value / resolution) * resolution;
+}
+
+
+static void _sample_scale(void) {
+    sim_scale_frame_t frame;
+    frame.weight = _quantise(filtered_mass + normal(rng) * plant_config.scale_noise_sd,
+                             plant_config.scale_resolution);
+
+    // Frames leave the scale in order, jitter only delays them
+    uint64_t jitter_us = (uint64_t) (uniform(rng) * plant_config.scale_frame_jitter_ms * 1000);
+    frame.arrival_us = now_us + (uint64_t) (plant_config.scale_latency_ms * 1000) + jitter_us;
+    if (frame.arrival_us < last_arrival_us) {
+        frame.arrival_us = last_arrival_us;
+    }
+    last_arrival_us = frame.arrival_us;
+
+    pending_frames.push_back(frame);
+}
+
+
+static void _release_powder(float mass) {
+    falling_powder.push_back({now_us + (uint64_t) (plant_config.fall_time_ms * 1000), mass});
+    in_flight_mass += mass;
+}
+
+
+static void _step(uint64_t dt_us) {
+    float dt_s = dt_us * 1e-6f;
+    float grains_per_rev[2] = {plant_config.coarse_grains_per_rev, plant_config.fine_grains_per_rev};
+
+    // Motor ramp and powder release
+    for (int idx = 0; idx < 2; idx++) {
+        float max_dv = plant_config.motor_acceleration_rps2 * dt_s;
+        float dv = commanded_speed[idx] - actual_speed[idx];
+        actual_speed[idx] += fmaxf(-max_dv, fminf(dv, max_dv));
+        position[idx] += actual_speed[idx] * dt_s;
+
+        // Running in reverse pulls powder back into the tube
+        float speed = fmaxf(actual_speed[idx], 0.0f);
+        float released = speed * grains_per_rev[idx] * fmaxf(0.0f, 1.0f + speed * plant_config.grains_per_rev_slope_pct / 100.0f) * dt_s;
+        if (released > 0) {
+            released *= fmaxf(0.0f, 1.0f + normal(rng) * plant_config.flow_noise_pct / 100.0f);
+        }
+
+        // Powder hanging over the end of the coarse tube builds up while it runs, dribbles in once it stops and is
+        // pulled back by running in reverse
+        if (idx == 0 && plant_config.coarse_hanging_grains > 0) {
+            float revs = actual_speed[idx] * dt_s;
+            if (revs > 0) {
+                float fill = (plant_config.coarse_hanging_grains - hanging_mass) * fminf(1.0f, revs / HANG_FILL_REVS);
+                fill = fmaxf(0.0f, fminf(fill, released));
+                hanging_mass += fill;
+                released -= fill;
+            }
+            else {
+                hanging_mass = fmaxf(0.0f, hanging_mass + revs * grains_per_rev[idx]);
+
+                float dribble = hanging_mass * (1.0f - expf(-(dt_us / 1000.0f) / plant_config.hanging_release_ms));
+                hanging_mass -= dribble;
+                released += dribble;
+            }
+        }
+
+        if (released > 0) {
+            _release_powder(released);
+        }
+    }
+
+    now_us += dt_us;
+
+    // Powder landing
+    while (!falling_powder.empty() && falling_powder.front().land_us <= now_us) {
+        landed_mass += falling_powder.front().mass;
+        in_flight_mass -= falling_powder.front().mass;
+        falling_powder.pop_front();
+    }
+
+    // Load cell filter
+    float alpha = (dt_us == SIM_STEP_US) ? step_alpha : 1.0f - expf(-(dt_us / 1000.0f) / plant_config.scale_settle_tau_ms);
+    filtered_mass += (landed_mass - filtered_mass) * alpha;
+
+    // Scale sampling and serial delivery
+    while (now_us >= next_sample_us) {
+        _sample_scale();
+        next_sample_us += (uint64_t) (plant_config.scale_frame_period_ms * 1000);
+    }
+
+    while (!pending_frames.empty() && pending_frames.front().arrival_us <= now_us) {
+        ready_frame = pending_frames.front();
+        last_reading = ready_frame.weight;
+        frame_ready = true;
+        pending_frames.pop_front();
+    }
+}
+
+
+void sim_plant_advance_to(uint64_t time_us) {
+    while (now_us < time_us) {
+        uint64_t dt_us = time_us - now_us;
+        _step(dt_us < SIM_STEP_US ? dt_us : SIM_STEP_US);
+    }
+}
+
+
+void sim_plant_set_motor_speed(int motor_idx, float speed_rps) {
+    commanded_speed[motor_idx] = speed_rps;
+}
+
+
+float sim_plant_get_motor_speed(int motor_idx) {
+    return commanded_speed[motor_idx];
+}
+
+
+float sim_plant_get_motor_position(int motor_idx) {
+    return (float) position[motor_idx];
+}
+
+
+bool sim_plant_wait_for_frame(uint64_t deadline_us, sim_scale_frame_t * frame) {
+    // Behaves like the binary semaphore given by the scale driver
+    while (!frame_ready && now_us < deadline_us) {
+        uint64_t dt_us = deadline_us - now_us;
+        _step(dt_us < SIM_STEP_US ? dt_us : SIM_STEP_US);
+    }
+
+    if (!frame_ready) {
+        return false;
+    }
+
+    frame_ready = false;
+    *frame = ready_frame;
+
+    return true;
+}
+
+
+float sim_plant_get_last_reading(void) {
+    return last_reading;
+}
+
+
+float sim_plant_get_landed_mass(void) {
+    return landed_mass;
+}
+
+
+float sim_plant_get_in_flight_mass(void) {
+    return in_flight_mass;
+}
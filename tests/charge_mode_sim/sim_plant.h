@@ -0,0 +1,81 @@
+#ifndef SIM_PLANT_H_
+#define SIM_PLANT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Closed-loop trickler plant model for the host simulator.
+ *
+ * The plant models both tricklers (motor ramp, powder flow per revolution with
+ * noise, free-fall delay, powder hanging over the end of the coarse tube), and the scale (first-order settling filter, noise,
+ * display resolution, sampling period, processing latency and serial frame
+ * jitter). All time is simulated and advanced explicitly by the HAL shims.
+ */
+
+typedef struct {
+    // Tricklers
+    float coarse_grains_per_rev;        // Mean powder mass per revolution of the coarse trickler
+    float fine_grains_per_rev;          // Mean powder mass per revolution of the fine trickler
+    float grains_per_rev_slope_pct;     // Change of the mass per revolution per rev/s, the tube fills less when fast
+    float flow_noise_pct;               // Relative standard deviation of flow, per millisecond
+    float motor_acceleration_rps2;      // Ramp rate of the simulated steppers
+    float fall_time_ms;                 // Time for powder to travel from the tube to the pan
+    float coarse_hanging_grains;        // Powder hanging over the end of the running coarse tube, 0 to disable
+    float hanging_release_ms;           // Time constant of the hanging powder dribbling in once stopped
+
+    // Scale
+    float scale_frame_period_ms;        // Interval between two weight frames
+    float scale_frame_jitter_ms;        // Uniform jitter added to the arrival of each frame
+    float scale_latency_ms;             // Delay from sampling to the frame arriving on the UART
+    float scale_settle_tau_ms;          // Time constant of the load cell filter
+    float scale_resolution;             // Display resolution, e.g. 0.02 gr
+    float scale_noise_sd;               // Standard deviation of the reading noise
+} sim_plant_config_t;
+
+
+typedef struct {
+    float weight;                       // Quantised reading as sent by the scale
+    uint64_t arrival_us;                // Time the frame is complete on the UART
+} sim_scale_frame_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_plant_get_default_config(sim_plant_config_t * config);
+void sim_plant_init(const sim_plant_config_t * config, uint32_t seed);
+
+// Start a new drop: empty pan, tricklers stopped, scale settled at zero
+void sim_plant_reset(void);
+
+// Simulated clock
+uint64_t sim_plant_now_us(void);
+void sim_plant_advance_to(uint64_t time_us);
+
+// Commanded trickler speed in rev/s (0: coarse, 1: fine)
+void sim_plant_set_motor_speed(int motor_idx, float speed_rps);
+float sim_plant_get_motor_speed(int motor_idx);
+
+// Revolutions the trickler has actually turned since init, following the ramps
+float sim_plant_get_motor_position(int motor_idx);
+
+// Returns true and the frame if a new frame arrives before `deadline_us`. The clock
+// is advanced to the arrival time, or to the deadline if no frame arrives.
+bool sim_plant_wait_for_frame(uint64_t deadline_us, sim_scale_frame_t * frame);
+
+// Latest frame received (NAN before the first frame)
+float sim_plant_get_last_reading(void);
+
+// Powder mass that physically landed in the pan
+float sim_plant_get_landed_mass(void);
+
+// Powder mass that left the tube but has not landed yet
+float sim_plant_get_in_flight_mass(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_PLANT_H_
@@ -0,0 +1,30 @@
+#ifndef SIM_FREERTOS_H_
+#define SIM_FREERTOS_H_
+
+// Host stand-in for the FreeRTOS kernel headers. Only the subset used by the
+// charge mode is provided; time is driven by the simulator (see sim_hal.cpp).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t configSTACK_DEPTH_TYPE;
+
+#define configTICK_RATE_HZ          ((TickType_t) 1000)
+#define configMINIMAL_STACK_SIZE    ((configSTACK_DEPTH_TYPE) 256)
+
+#define portMAX_DELAY               ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS          ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS            portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms)           ((TickType_t) (((uint64_t) (ms) * configTICK_RATE_HZ) / 1000U))
+
+#define pdFALSE                     ((BaseType_t) 0)
+#define pdTRUE                      ((BaseType_t) 1)
+#define pdPASS                      pdTRUE
+#define pdFAIL                      pdFALSE
+
+#endif  // SIM_FREERTOS_H_
@@ -0,0 +1,10 @@
+#ifndef SIM_HARDWARE_PIO_H_
+#define SIM_HARDWARE_PIO_H_
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t * PIO;
+
+#endif  // SIM_HARDWARE_PIO_H_
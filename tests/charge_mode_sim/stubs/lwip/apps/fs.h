@@ -0,0 +1,16 @@
+#ifndef SIM_LWIP_FS_H_
+#define SIM_LWIP_FS_H_
+
+#include <stdint.h>
+
+#define FS_FILE_FLAGS_HEADER_INCLUDED     0x01
+#define FS_FILE_FLAGS_HEADER_PERSISTENT   0x02
+
+struct fs_file {
+    const char *data;
+    int len;
+    int index;
+    uint8_t flags;
+};
+
+#endif  // SIM_LWIP_FS_H_
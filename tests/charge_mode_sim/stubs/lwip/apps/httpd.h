@@ -0,0 +1,11 @@
+#ifndef SIM_LWIP_HTTPD_H_
+#define SIM_LWIP_HTTPD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define LWIP_HTTPD_DYNAMIC_HEADERS  0
+#define LWIP_HTTPD_SSI              0
+
+#endif  // SIM_LWIP_HTTPD_H_
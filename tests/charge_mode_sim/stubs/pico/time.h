@@ -0,0 +1,18 @@
+#ifndef SIM_PICO_TIME_H_
+#define SIM_PICO_TIME_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void busy_wait_us(uint64_t delay_us);
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_PICO_TIME_H_
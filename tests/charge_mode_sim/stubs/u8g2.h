@@ -0,0 +1,36 @@
+#ifndef SIM_U8G2_H_
+#define SIM_U8G2_H_
+
+// Headless stand-in for u8g2. The simulator never runs the render task, but the
+// charge mode translation unit references these symbols.
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t unused;
+} u8g2_t;
+
+typedef uint8_t u8g2_font_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const uint8_t u8g2_font_helvB08_tr[];
+extern const uint8_t u8g2_font_helvR08_tr[];
+extern const uint8_t u8g2_font_profont22_tf[];
+extern const uint8_t u8g2_font_profont11_tf[];
+
+void u8g2_ClearBuffer(u8g2_t *u8g2);
+void u8g2_SendBuffer(u8g2_t *u8g2);
+void u8g2_SetFont(u8g2_t *u8g2, const uint8_t *font);
+uint16_t u8g2_DrawStr(u8g2_t *u8g2, uint16_t x, uint16_t y, const char *str);
+void u8g2_DrawHLine(u8g2_t *u8g2, uint16_t x, uint16_t y, uint16_t w);
+uint16_t u8g2_GetStrWidth(u8g2_t *u8g2, const char *s);
+uint16_t u8g2_GetDisplayWidth(u8g2_t *u8g2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SIM_U8G2_H_